@@ -4,12 +4,14 @@
 #include "board.hpp"
 #include "constants.hpp"
 
+#ifdef ROTATED_BOARDS
 void rotate_board(U8 *src, U8 *tgt, const U8 *transform) {
 
     for (int i=0; i<64; i++) {
         tgt[transform[i]] = src[i];
     }
 }
+#endif
 
 void BoardData::set_pieces_on_board() {
 
@@ -35,31 +37,68 @@ void BoardData::set_pieces_on_board() {
     if (this->w_pawn_3   != DEAD) this->board_0[this->w_pawn_3]   = WHITE | PAWN ;
     if (this->w_pawn_4   != DEAD) this->board_0[this->w_pawn_4]   = WHITE | PAWN ;
 
-    rotate_board(this->board_0, this->board_90, this->transform_array[1]);
-    rotate_board(this->board_0, this->board_180, this->transform_array[2]);
-    rotate_board(this->board_0, this->board_270, this->transform_array[3]);
+#ifdef ROTATED_BOARDS
+    const U8 *const *transforms = rotation_transforms(this->board_type);
+    rotate_board(this->board_0, this->board_90, transforms[1]);
+    rotate_board(this->board_0, this->board_180, transforms[2]);
+    rotate_board(this->board_0, this->board_270, transforms[3]);
+#endif
+
+    this->set_piece_index();
+    this->set_bitboards();
 }
 
-void BoardData::set_7x7_transforms() {
-    this->transform_array[0]         = (U8*)id_7x7;
-    this->transform_array[1]         = (U8*)cw_90_7x7;
-    this->transform_array[2]         = (U8*)cw_180_7x7;
-    this->transform_array[3]         = (U8*)acw_90_7x7;
-    this->inverse_transform_array[0] = (U8*)id_7x7;
-    this->inverse_transform_array[1] = (U8*)acw_90_7x7;
-    this->inverse_transform_array[2] = (U8*)cw_180_7x7;
-    this->inverse_transform_array[3] = (U8*)cw_90_7x7;
+void BoardData::set_piece_index() {
+
+    memset(this->piece_index, DEAD, 64);
+
+    U8 *pieces = (U8*)this;
+    for (int i=0; i<2*this->n_pieces; i++) {
+        if (pieces[i] != DEAD) this->piece_index[pieces[i]] = i;
+    }
 }
 
-void BoardData::set_8x8_transforms() {
-    this->transform_array[0]         = (U8*)id_8x8;
-    this->transform_array[1]         = (U8*)cw_90_8x8;
-    this->transform_array[2]         = (U8*)cw_180_8x8;
-    this->transform_array[3]         = (U8*)acw_90_8x8;
-    this->inverse_transform_array[0] = (U8*)id_8x8;
-    this->inverse_transform_array[1] = (U8*)acw_90_8x8;
-    this->inverse_transform_array[2] = (U8*)cw_180_8x8;
-    this->inverse_transform_array[3] = (U8*)cw_90_8x8;
+void BoardData::set_bitboards() {
+
+    memset(this->color_bb, 0, sizeof(this->color_bb));
+    memset(this->piece_bb, 0, sizeof(this->piece_bb));
+
+    for (int i=0; i<64; i++) {
+        U8 piece = this->board_0[i];
+        if (!(piece & (WHITE | BLACK))) continue;
+        this->color_bb[color_idx(piece & (WHITE | BLACK))] |= sqbit(i);
+        this->piece_bb[piece_idx(piece)] |= sqbit(i);
+    }
+
+    this->hash = this->compute_hash();
+    this->psqt = this->compute_psqt();
+    if (nnue_enabled) nnue_refresh(this->nnue, this->board_0, this->board_type);
+}
+
+U64 BoardData::compute_hash() const {
+
+    U64 h = zobrist_keys.board_type[this->board_type];
+    if (this->player_to_play == BLACK) h ^= zobrist_keys.black_to_play;
+
+    for (int i=0; i<64; i++) {
+        U8 piece = this->board_0[i];
+        if (!(piece & (WHITE | BLACK))) continue;
+        h ^= zobrist_piece(piece, i);
+    }
+
+    return h;
+}
+
+int BoardData::compute_psqt() const {
+
+    int score = 0;
+    for (int i=0; i<64; i++) {
+        U8 piece = this->board_0[i];
+        if (!(piece & (WHITE | BLACK))) continue;
+        score += pst_value(this->board_type, piece, i);
+    }
+
+    return score;
 }
 
 void BoardData::set_7_3_layout() {
@@ -76,10 +115,6 @@ void BoardData::set_7_3_layout() {
     this->w_bishop = pos(3,0);
     this->w_pawn_1 = pos(2,1);
     this->w_pawn_2 = pos(2,0);
-
-    this->pawn_promo_squares[0] = pos(2,0);
-    this->pawn_promo_squares[1] = pos(2,1);
-    this->n_pawn_promo_squares = 2;
 }
 
 void BoardData::set_8_4_layout() {
@@ -100,10 +135,6 @@ void BoardData::set_8_4_layout() {
     this->b_rook_2 = pos(3,7);
     this->b_pawn_3 = pos(5,6);
     this->b_pawn_4 = pos(5,7);
-
-    this->pawn_promo_squares[0] = pos(2,0);
-    this->pawn_promo_squares[1] = pos(2,1);
-    this->n_pawn_promo_squares = 2;
 }
 
 void BoardData::set_8_2_layout() {
@@ -128,37 +159,28 @@ void BoardData::set_8_2_layout() {
     this->b_bishop   = pos(3,5);
     this->b_rook_1   = pos(2,6);
     this->b_rook_2   = pos(2,7);
-
-    this->pawn_promo_squares[0] = pos(2,0);
-    this->pawn_promo_squares[1] = pos(2,1);
-    this->pawn_promo_squares[2] = pos(2,2);
-    this->n_pawn_promo_squares = 3;
 }
 
 BoardData::BoardData(BoardType btype): 
-    board_0{0}, 
+    board_0{0}
+#ifdef ROTATED_BOARDS
+    ,
     board_90{0}, 
     board_180{0}, 
-    board_270{0}, 
-    pawn_promo_squares{0} {
+    board_270{0}
+#endif
+    {
 
     this->board_type = btype;
 
     if (btype == SEVEN_THREE) {
         this->set_7_3_layout();
-        this->set_7x7_transforms();
-        this->board_mask = (U8*)board_7_3;
+    }
+    else if (btype == EIGHT_FOUR) {
+        this->set_8_4_layout();
     }
     else {
-        this->set_8x8_transforms();
-        if (btype == EIGHT_FOUR) {
-            this->set_8_4_layout();
-            this->board_mask = (U8*)board_8_4;
-        }
-        else {
-            this->set_8_2_layout();
-            this->board_mask = (U8*)board_8_2;
-        }
+        this->set_8_2_layout();
     }
 
     this->set_pieces_on_board();
@@ -191,19 +213,21 @@ BoardData::BoardData(const BoardData& source) {
     this->w_pawn_4   = source.w_pawn_4   ;
 
     memcpy(this->board_0  , source.board_0  , 64);
+#ifdef ROTATED_BOARDS
     memcpy(this->board_90 , source.board_90 , 64);
     memcpy(this->board_180, source.board_180, 64);
     memcpy(this->board_270, source.board_270, 64);
+#endif
+
+    memcpy(this->piece_index, source.piece_index, 64);
+    memcpy(this->color_bb, source.color_bb, sizeof(this->color_bb));
+    memcpy(this->piece_bb, source.piece_bb, sizeof(this->piece_bb));
 
     this->board_type = source.board_type;
-    this->board_mask = source.board_mask;
     this->player_to_play = source.player_to_play;
     this->last_killed_piece = source.last_killed_piece;
     this->last_killed_piece_idx = source.last_killed_piece_idx;
-
-    memcpy(this->transform_array, source.transform_array, 4*sizeof(U8*));
-    memcpy(this->inverse_transform_array, source.inverse_transform_array, 4*sizeof(U8*));
-
-    memcpy(this->pawn_promo_squares, source.pawn_promo_squares, 10);
-    this->n_pawn_promo_squares = source.n_pawn_promo_squares;
+    this->hash = source.hash;
+    this->psqt = source.psqt;
+    if (nnue_enabled) this->nnue = source.nnue;
 }
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <string>
 #include <vector>
 #include <unordered_set>
 #include <stack>
 #include "constants.hpp"
+#include "rays.hpp"
+#include "zobrist.hpp"
+#include "pst.hpp"
+#include "nnue.hpp"
 
 /**
  * Declares PlayerColor enum with possible values: WHITE, BLACK.
@@ -76,26 +81,45 @@ struct BoardData {
 
   static const int n_pieces = 10;
 
-  // Array that holds the board state from different orientations.
+  // Array that holds the board state from different orientations. Move
+  // generation only needs board_0; the rotated copies are maintained only when
+  // built with -DROTATED_BOARDS, for code that still reads them.
   U8 board_0[64];
+#ifdef ROTATED_BOARDS
   U8 board_90[64];
   U8 board_180[64];
   U8 board_270[64];
+#endif
+
+  // Bitboards mirroring board_0: occupancy per color (indexed by color_idx)
+  // and per piece type (indexed by piece_idx). Kept in sync by make/unmake.
+  U64 color_bb[2] = {0, 0};
+  U64 piece_bb[6] = {0, 0, 0, 0, 0, 0};
+
+  // Square to piece lookup: the offset of the position field (w_rook_1 ..
+  // b_pawn_4) of the piece on each square, or DEAD if the square is empty.
+  // Kept in sync by make/unmake.
+  U8 piece_index[64];
 
   // Variables that record the game status and configuration.
+  // The layout's geometry (mask, rays, promotion squares) is constant per
+  // board type and lives in Layout<BT> (movegen.hpp).
   BoardType board_type = SEVEN_THREE;
-  U8 *board_mask;
   PlayerColor player_to_play = WHITE;
   U8 last_killed_piece = 0;
   int last_killed_piece_idx = -1;
 
-  // Transformation arrays for 90, 180, and 270 degree rotations of the matrix.
-  U8 *transform_array[4];
-  U8 *inverse_transform_array[4];
+  // Zobrist hash of the position (pieces, player to play and board type),
+  // updated incrementally by make/unmake and flip_player_.
+  U64 hash = 0;
+
+  // Material plus piece-square score of the position from white's point of
+  // view, updated incrementally by make/unmake.
+  int psqt = 0;
 
-  // Variables that represent pawn promotion squares
-  U8 pawn_promo_squares[10];
-  int n_pawn_promo_squares;
+  // First layer of the neural evaluation, updated incrementally by
+  // make/unmake while a network is loaded (nnue_enabled).
+  NNUEAccumulator nnue;
 
   /**
    * Default constructor - initializes an instance of the BoardData structure.
@@ -122,31 +146,51 @@ struct BoardData {
   void set_pieces_on_board();
 
   /**
-   * member function that sets the board layout for 8x4.
+   * member function that sets the piece index from the piece positions.
    */
-  void set_8_4_layout();
+  void set_piece_index();
 
   /**
-   * member function that sets the board layout for 8x2.
+   * member function that sets the bitboards from board_0.
    */
-  void set_8_2_layout();
+  void set_bitboards();
 
   /**
-   * member function that sets the board layout for 7x3.
+   * member function that computes the Zobrist hash of the position from
+   * scratch.
+   * @return the hash of the current position.
    */
-  void set_7_3_layout();
+  U64 compute_hash() const;
+
+  /**
+   * member function that computes the material plus piece-square score of
+   * the position from scratch.
+   * @return the score from white's point of view.
+   */
+  int compute_psqt() const;
 
   /**
-   * member function that implements 7x7 transforms.
-   * Sets the transformation and inverse transformation arrays to represent 7x7
-   * board rotation.
+   * member function that sets the board layout for 8x4.
+   */
+  void set_8_4_layout();
+
+  /**
+   * member function that sets the board layout for 8x2.
    */
-  void set_7x7_transforms();
+  void set_8_2_layout();
 
   /**
-   * member function that implements 8x8 transforms.
-   * Sets the transformation and inverse transformation arrays to represent 8x8
-   * board rotation.
+   * member function that sets the board layout for 7x3.
    */
-  void set_8x8_transforms();
+  void set_7_3_layout();
 };
+
+#ifdef ROTATED_BOARDS
+/**
+ * Square maps from board_0 to board_90, board_180 and board_270 (indices 1
+ * to 3) for a board type.
+ */
+inline const U8 *const *rotation_transforms(BoardType btype) {
+    return btype == SEVEN_THREE ? transforms_7x7 : transforms_8x8;
+}
+#endif
@@ -1,252 +1,49 @@
+#include <algorithm>
 #include <string>
 #include <iostream>
 #include "board.hpp"
+#include "movegen.hpp"
 #include "butils.hpp"
 #include "constants.hpp"
 #include <cstring>
-
-std::unordered_set<U16> transform_moves(const std::unordered_set<U16>& moves, const U8 *transform) {
-
-    std::unordered_set<U16> rot_moves;
-
-    for (U16 move : moves) {
-        rot_moves.insert(move_promo(transform[getp0(move)], transform[getp1(move)], getpromo(move)));
-    }
-
-    return rot_moves;
-}
-
-std::unordered_set<U16> construct_rook_moves(const U8 p0, const U8 *board, const U8 *bmask) {
-
-    PlayerColor color = color(board[p0]);
-    PlayerColor oppcolor = oppcolor(board[p0]);
-    std::unordered_set<U16> rook_moves;
-
-    // right - move one square 
-    if (inboard(bmask, getx(p0)+1, gety(p0)) && 
-        !occupied(board, p0+pos(1,0), color)) rook_moves.insert(move(p0, p0+pos(1,0)));
-
-    // bottom - move one square 
-    if (inboard(bmask, getx(p0), gety(p0)-1) && 
-        !occupied(board, p0-pos(0,1), color)) rook_moves.insert(move(p0, p0-pos(0,1)));
-
-    // top - move multiple if left end (forward), move one if right end
-    if (inboard(bmask, getx(p0), gety(p0)+1)) {
-        if (getx(p0) >= 4 && !occupied(board, p0+pos(0,1), color)) {
-            // right end 
-            rook_moves.insert(move(p0, p0+pos(0,1)));
-        }
-        else {
-            for (int y=1; inboard(bmask, getx(p0), gety(p0)+y); y++) {
-                U8 tgt_pos = p0+pos(0,y);
-                if (occupied(board, tgt_pos, color)) break;
-                
-                rook_moves.insert(move(p0, tgt_pos));
-                if (occupied(board, tgt_pos, oppcolor)) break;
-            }
-        }
-    }
-
-    // left
-    bool blocked = false;
-    for (int x=1; inboard(bmask, getx(p0)-x, gety(p0)); x++) {
-        U8 tgt_pos = p0-pos(x,0);
-        if (occupied(board, tgt_pos, color)) { blocked = true; break; }
-        
-        rook_moves.insert(move(p0, tgt_pos));
-        if (occupied(board, tgt_pos, oppcolor)) { blocked = true; break; }
-    }
-
-    // reflect if on outer ring and not blocked yet
-    if (!blocked && gety(p0) == 0) {
-        for (int y=1; inboard(bmask, 0, y); y++) {
-            U8 tgt_pos = pos(0,y);
-            if (occupied(board, tgt_pos, color)) break;
-            
-            rook_moves.insert(move(p0, tgt_pos));
-            if (occupied(board, tgt_pos, oppcolor)) break;
-        }
-    }
-
-    return rook_moves;
-}
-
-std::unordered_set<U16> construct_bishop_moves(const U8 p0, const U8 *board, const U8 *bmask) {
-
-    PlayerColor color = color(board[p0]);
-    PlayerColor oppcolor = oppcolor(board[p0]);
-    std::unordered_set<U16> bishop_moves;
-
-    // top right - move one square 
-    if (inboard(bmask, getx(p0)+1, gety(p0)+1) && 
-        !occupied(board, p0+pos(1,1), color)) bishop_moves.insert(move(p0, p0+pos(1,1)));
-
-    // bottom right - move one square 
-    if (inboard(bmask, getx(p0)+1, gety(p0)-1) && 
-        !occupied(board, p0+pos(1,0)-pos(0,1), color)) 
-        bishop_moves.insert(move(p0, p0+pos(1,0)-pos(0,1)));
-
-    // top left - move till reflection, then reflect
-    bool blocked = false;
-    U8 tgt_pos = DEAD;
-    for (int s=1; inboard(bmask, getx(p0)-s, gety(p0)+s); s++) {
-        tgt_pos = p0-pos(s,0)+pos(0,s);
-        if (occupied(board, tgt_pos, color)) { blocked = true; break; }
-        
-        bishop_moves.insert(move(p0, tgt_pos));
-        if (occupied(board, tgt_pos, oppcolor)) { blocked = true; break; }
-    }
-
-    // reflect on left / top edge
-    if (!blocked) {
-        // std::cout << "Not blocked, reflecting\n";
-        U8 p1 = tgt_pos;
-        if (getx(tgt_pos) == 0) {
-            // left edge 
-            for (int s=1; inboard(bmask, getx(p1)+s, gety(p1)+s); s++) {
-                U8 tgt_pos = p1+pos(s,s);
-                if (occupied(board, tgt_pos, color)) { blocked = true; break; }
-                
-                bishop_moves.insert(move(p0, tgt_pos));
-                if (occupied(board, tgt_pos, oppcolor)) { blocked = true; break; }
-            }
-        }
-        else {
-            // top edge
-            for (int s=1; inboard(bmask, getx(p1)-s, gety(p1)-s); s++) {
-                U8 tgt_pos = p1-pos(s,s);
-                if (occupied(board, tgt_pos, color)) { blocked = true; break; }
-                
-                bishop_moves.insert(move(p0, tgt_pos));
-                if (occupied(board, tgt_pos, oppcolor)) { blocked = true; break; }
-            }
-        }
-    }
-
-    // bottom left - move till reflection, then reflect
-    blocked = false;
-    tgt_pos = DEAD;
-    for (int s=1; inboard(bmask, getx(p0)-s, gety(p0)-s); s++) {
-        tgt_pos = p0-pos(s,s);
-        if (occupied(board, tgt_pos, color)) { blocked = true; break; }
-        
-        bishop_moves.insert(move(p0, tgt_pos));
-        if (occupied(board, tgt_pos, oppcolor)) { blocked = true; break; }
-    }
-
-    // reflect on bottom edge
-    if (!blocked) {
-        U8 p1 = tgt_pos;
-        for (int s=1; inboard(bmask, getx(p1)-s, gety(p1)+s); s++) {
-            tgt_pos = p1-pos(s,0)+pos(0,s);
-            if (occupied(board, tgt_pos, color)) { blocked = true; break; }
-            
-            bishop_moves.insert(move(p0, tgt_pos));
-            if (occupied(board, tgt_pos, oppcolor)) { blocked = true; break; }
-        }
-    }
-
-    return bishop_moves;
+#include <cassert>
+
+// Debug builds (-DDEBUG) check the incrementally updated hash, score and
+// network accumulator against a recompute from scratch after every change to
+// the position, and that the piece index points at the piece being moved.
+#ifdef DEBUG
+static bool check_nnue(const BoardData &d) {
+    if (!nnue_enabled) return true;
+    NNUEAccumulator acc;
+    nnue_refresh(acc, d.board_0, d.board_type);
+    return memcmp(&acc, &d.nnue, sizeof(acc)) == 0;
 }
-
-std::unordered_set<U16> construct_knight_moves(const U8 p0, const U8 *board, const U8 *bmask) {
-
-    PlayerColor color = color(board[p0]);
-    std::unordered_set<U16> knight_moves;
-
-    // similar to king moves
-    int x_incrs[8] = {1, 2,  2,  1, -1, -2, -2, -1};
-    int y_incrs[8] = {2, 1, -1, -2, -2, -1,  1,  2};
-
-    for (int i=0; i<8; i++) {
-        if (!inboard(bmask, getx(p0)+x_incrs[i], gety(p0)+y_incrs[i])) continue;
-        U8 p1 = pos(getx(p0)+x_incrs[i], gety(p0)+y_incrs[i]);
-        if (!occupied(board, p1, color)) knight_moves.insert(move(p0, p1));
-    }
-
-    return knight_moves;
-}
-
-bool can_promote(U8 pos, U8 *promo, int n_promo) {
-    for (int i=0; i<n_promo; i++) {
-        if (promo[i] == pos) return true;
+#define check_hash(d) assert((d).hash == (d).compute_hash() && (d).psqt == (d).compute_psqt() && check_nnue(d))
+#define check_piece_index(d, idx, sq) assert((idx) != DEAD && ((const U8*)&(d))[idx] == (sq))
+#else
+#define check_hash(d)
+#define check_piece_index(d, idx, sq)
+#endif
+
+bool MoveList::contains(U16 move) const {
+    for (int i=0; i<this->n_moves; i++) {
+        if (this->moves[i] == move) return true;
     }
     return false;
 }
 
-std::unordered_set<U16> construct_pawn_moves(const U8 p0, const U8 *board, const U8 *bmask,
-        U8 *promo, int n_promo, bool promote) {
-    
-    PlayerColor color = color(board[p0]);
-    std::unordered_set<U16> pawn_moves;
-
-    for (int y = gety(p0)-1; y <= gety(p0) + 1; y++) {
-        if (!inboard(bmask, getx(p0)-1, y)) continue;
-        U8 p1 = pos(getx(p0)-1, y);
-        if (!occupied(board, p1, color)) {
-            if (promote && can_promote(p1, promo, n_promo)) {
-                pawn_moves.insert(move_promo(p0, p1, PAWN_ROOK));
-                pawn_moves.insert(move_promo(p0, p1, PAWN_BISHOP));
-            }
-            else {
-                pawn_moves.insert(move(p0, p1));
-            }
-        }
-    }
+void Board::generate_pseudolegal_for_piece(U8 piece_pos, MoveList& moves) const {
 
-    return pawn_moves;
-}
-
-std::unordered_set<U16> construct_king_moves(const U8 p0, const U8 *board, const U8 *bmask) {
-
-    PlayerColor color = color(board[p0]);
-    std::unordered_set<U16> king_moves;
-
-    int x_incrs[8] = {1, 1,  1, 0,  0, -1, -1, -1};
-    int y_incrs[8] = {1, 0, -1, 1, -1,  1,  0, -1};
-
-    for (int i=0; i<8; i++) {
-        if (!inboard(bmask, getx(p0)+x_incrs[i], gety(p0)+y_incrs[i])) continue;
-        U8 p1 = pos(getx(p0)+x_incrs[i], gety(p0)+y_incrs[i]);
-        if (!occupied(board, p1, color)) king_moves.insert(move(p0, p1));
-    }
-
-    return king_moves;
+    with_layout(this->data.board_type, [&](auto layout) {
+        generate_piece_moves<decltype(layout)::type>(this->data, piece_pos, moves);
+    });
 }
 
 std::unordered_set<U16> Board::get_pseudolegal_moves_for_piece(U8 piece_pos) const {
 
-    std::unordered_set<U16> moves;
-    U8 piece_id = this->data.board_0[piece_pos];
-    int board_idx = data.board_mask[piece_pos] - 2;
-    const U8 *transform_arr = this->data.transform_array[board_idx];
-    const U8 *inv_transform_arr = this->data.inverse_transform_array[board_idx];
-
-    const U8 *board = this->data.board_0;
-    if (board_idx == 1) board = this->data.board_270;
-    if (board_idx == 2) board = this->data.board_180;
-    if (board_idx == 3) board = this->data.board_90;
-
-    if (piece_id & PAWN) {
-        moves = construct_pawn_moves(inv_transform_arr[piece_pos], board, this->data.board_mask,
-                (U8*)this->data.pawn_promo_squares, this->data.n_pawn_promo_squares,
-                (board_idx==2 && (piece_id & WHITE)) || (board_idx==0 && (piece_id & BLACK)));
-    }
-    else if (piece_id & ROOK) {
-        moves = construct_rook_moves(inv_transform_arr[piece_pos], board, this->data.board_mask);
-    }
-    else if (piece_id & BISHOP) {
-        moves = construct_bishop_moves(inv_transform_arr[piece_pos], board, this->data.board_mask);
-    }
-    else if (piece_id & KING) {
-        moves = construct_king_moves(inv_transform_arr[piece_pos], board, this->data.board_mask);
-    }
-    else if (piece_id & KNIGHT) {
-        moves = construct_knight_moves(inv_transform_arr[piece_pos], board, this->data.board_mask);
-    }
-
-    moves = transform_moves(moves, transform_arr);
-    return moves;
+    MoveList moves;
+    this->generate_pseudolegal_for_piece(piece_pos, moves);
+    return std::unordered_set<U16>(moves.begin(), moves.end());
 }
 
 Board::Board(): data{SEVEN_THREE} {}
@@ -259,22 +56,38 @@ Board::Board(BoardData bdata) {
 
 Board::Board(const Board& source) {
     this->data = source.data; // copy constructor
+
+    // only the live part of the undo stack is worth copying
+    this->n_undo = source.n_undo;
+    int n = std::min(source.n_undo, undo_capacity);
+    int top = source.n_undo % undo_capacity;
+    if (n <= top) {
+        memcpy(this->undo_stack + top - n, source.undo_stack + top - n, n * sizeof(UndoRecord));
+    }
+    else {
+        memcpy(this->undo_stack, source.undo_stack, top * sizeof(UndoRecord));
+        memcpy(this->undo_stack + undo_capacity - (n - top), source.undo_stack + undo_capacity - (n - top),
+               (n - top) * sizeof(UndoRecord));
+    }
 }
 
-bool Board::under_threat(U8 piece_pos) const {
+bool Board::is_square_attacked(U8 sq, U8 by_color) const {
 
-    auto pseudolegal_moves = this->get_pseudolegal_moves_for_side(this->data.player_to_play ^ (WHITE | BLACK));
+    return with_layout(this->data.board_type, [&](auto layout) {
+        return square_attacked<decltype(layout)::type>(this->data, sq, by_color);
+    });
+}
 
-    for (auto move : pseudolegal_moves) {
-        // std::cout << move_to_str(move) << " ";
-        if (getp1(move) == piece_pos) {
-            // std::cout << "<- causes check\n";
-            return true;
-        }
-    }
-    // std::cout << std::endl;
+int Board::see(U16 move) const {
 
-    return false;
+    return with_layout(this->data.board_type, [&](auto layout) {
+        return static_exchange<decltype(layout)::type>(this->data, move);
+    });
+}
+
+bool Board::under_threat(U8 piece_pos) const {
+
+    return this->is_square_attacked(piece_pos, this->data.player_to_play ^ (WHITE | BLACK));
 }
 
 bool Board::in_check() const {
@@ -283,6 +96,7 @@ bool Board::in_check() const {
     if (this->data.player_to_play == BLACK) {
         king_pos = this->data.b_king;
     }
+    if (king_pos == DEAD) return false;
 
     return under_threat(king_pos);
 }
@@ -291,21 +105,22 @@ std::unordered_set<U16> Board::get_pseudolegal_moves() const {
     return get_pseudolegal_moves_for_side(this->data.player_to_play);
 }
 
-std::unordered_set<U16> Board::get_pseudolegal_moves_for_side(U8 color) const {
+void Board::generate_pseudolegal(MoveList& moves) const {
+    generate_pseudolegal_for_side(this->data.player_to_play, moves);
+}
 
-    std::unordered_set<U16> pseudolegal_moves;
+std::unordered_set<U16> Board::get_pseudolegal_moves_for_side(U8 color) const {
 
-    int si = (color>>7) * 10;
+    MoveList moves;
+    this->generate_pseudolegal_for_side(color, moves);
+    return std::unordered_set<U16>(moves.begin(), moves.end());
+}
 
-    U8 *pieces = (U8*)(&this->data);
-    for (int i=0; i<this->data.n_pieces; i++) {
-        U8 piece = pieces[si+i];
-        if (piece == DEAD) continue;
-        auto piece_moves = this->get_pseudolegal_moves_for_piece(piece);
-        pseudolegal_moves.insert(piece_moves.begin(), piece_moves.end());
-    }
+void Board::generate_pseudolegal_for_side(U8 color, MoveList& moves) const {
 
-    return pseudolegal_moves;
+    with_layout(this->data.board_type, [&](auto layout) {
+        generate_side_moves<decltype(layout)::type>(this->data, color, moves);
+    });
 }
 
 // legal move generation:
@@ -317,30 +132,72 @@ std::unordered_set<U16> Board::get_pseudolegal_moves_for_side(U8 color) const {
 //         add to legal moves
 std::unordered_set<U16> Board::get_legal_moves() const {
 
-    Board c(*this);
-    auto pseudolegal_moves = c.get_pseudolegal_moves();
-    std::unordered_set<U16> legal_moves;
-
-    for (auto move : pseudolegal_moves) {
-        c.do_move_without_flip_(move);
+    MoveList legal_moves;
+    this->generate_legal(legal_moves);
+    return std::unordered_set<U16>(legal_moves.begin(), legal_moves.end());
+}
 
-        if (!c.in_check()) {
-            legal_moves.insert(move);
-        }
+void Board::generate_legal(MoveList& legal_moves) const {
 
-        c.undo_last_move_without_flip_(move);
-    }
-
-    return legal_moves;
+    with_layout(this->data.board_type, [&](auto layout) {
+        generate_legal_moves<decltype(layout)::type>(*this, legal_moves);
+    });
 }
 
 void Board::do_move_(U16 move) {
+
+    UndoRecord &u = this->undo_stack[this->n_undo % undo_capacity];
+    u.move = move;
+    u.prev_last_killed_piece = this->data.last_killed_piece;
+    u.prev_last_killed_piece_idx = this->data.last_killed_piece_idx;
+    u.prev_hash = this->data.hash;
+
     do_move_without_flip_(move);
     flip_player_();
+
+    u.killed_piece = this->data.last_killed_piece;
+    u.killed_piece_idx = this->data.last_killed_piece_idx;
+    this->n_undo++;
+}
+
+void Board::undo_move_() {
+
+    assert(this->n_undo > 0);
+    this->n_undo--;
+    const UndoRecord &u = this->undo_stack[this->n_undo % undo_capacity];
+
+    this->data.last_killed_piece = u.killed_piece;
+    this->data.last_killed_piece_idx = u.killed_piece_idx;
+    flip_player_();
+    undo_last_move_without_flip_(u.move);
+
+    this->data.last_killed_piece = u.prev_last_killed_piece;
+    this->data.last_killed_piece_idx = u.prev_last_killed_piece_idx;
+    this->data.hash = u.prev_hash;
 }
 
 void Board::flip_player_() {
     this->data.player_to_play = (PlayerColor)(this->data.player_to_play ^ (WHITE | BLACK));
+    this->data.hash ^= zobrist_keys.black_to_play;
+    check_hash(this->data);
+}
+
+U64 Board::hash() const {
+    return this->data.hash;
+}
+
+int Board::repetitions() const {
+
+    // only positions with the same player to play can be equal, and none
+    // before a capture or a promotion, which had other pieces on the board
+    int n = std::min(this->n_undo, undo_capacity);
+    int count = 0;
+    for (int back=1; back<=n; back++) {
+        const UndoRecord &u = this->undo_stack[(this->n_undo - back) % undo_capacity];
+        if (u.killed_piece != 0 || getpromo(u.move) != 0) break;
+        if (back % 2 == 0 && u.prev_hash == this->data.hash) count++;
+    }
+    return count;
 }
 
 void Board::do_move_without_flip_(U16 move) {
@@ -353,19 +210,24 @@ void Board::do_move_without_flip_(U16 move) {
     this->data.last_killed_piece = 0;
     this->data.last_killed_piece_idx = -1;
 
-    // scan and get piece from coord
-    U8 *pieces = (U8*)this;
-    for (int i=0; i<2*this->data.n_pieces; i++) {
-        if (pieces[i] == p1) {
-            pieces[i] = DEAD;
-            this->data.last_killed_piece = this->data.board_0[p1];
-            this->data.last_killed_piece_idx = i;
-        }
-        if (pieces[i] == p0) {
-            pieces[i] = p1;
-        }
+    // look up the moving and captured pieces in the piece index
+    U8 *pieces = (U8*)(&(this->data));
+    U8 moved_idx = this->data.piece_index[p0];
+    U8 killed_idx = this->data.piece_index[p1];
+    // moving from an empty square would write past the piece fields
+    assert(moved_idx != DEAD);
+    check_piece_index(this->data, moved_idx, p0);
+
+    if (killed_idx != DEAD) {
+        pieces[killed_idx] = DEAD;
+        this->data.last_killed_piece = this->data.board_0[p1];
+        this->data.last_killed_piece_idx = killed_idx;
     }
+    pieces[moved_idx] = p1;
+    this->data.piece_index[p1] = moved_idx;
+    this->data.piece_index[p0] = DEAD;
 
+    U8 movedpiece = piecetype;
     if (promo == PAWN_ROOK) {
         piecetype = (piecetype & (WHITE | BLACK)) | ROOK;
     }
@@ -373,15 +235,38 @@ void Board::do_move_without_flip_(U16 move) {
         piecetype = (piecetype & (WHITE | BLACK)) | BISHOP;
     }
 
-    this->data.board_0  [this->data.transform_array[0][p1]] = piecetype;
-    this->data.board_90 [this->data.transform_array[1][p1]] = piecetype;
-    this->data.board_180[this->data.transform_array[2][p1]] = piecetype;
-    this->data.board_270[this->data.transform_array[3][p1]] = piecetype;
+    U8 deadpiece = this->data.board_0[p1];
+    if (deadpiece) {
+        this->data.color_bb[color_idx(color(deadpiece))] ^= sqbit(p1);
+        this->data.piece_bb[piece_idx(deadpiece)] ^= sqbit(p1);
+        this->data.hash ^= zobrist_piece(deadpiece, p1);
+        this->data.psqt -= pst_value(this->data.board_type, deadpiece, p1);
+        if (nnue_enabled) nnue_remove(this->data.nnue, this->data.board_type, deadpiece, p1);
+    }
+    this->data.color_bb[color_idx(color(movedpiece))] ^= sqbit(p0) | sqbit(p1);
+    this->data.piece_bb[piece_idx(movedpiece)] ^= sqbit(p0);
+    this->data.piece_bb[piece_idx(piecetype)] ^= sqbit(p1);
+    this->data.hash ^= zobrist_piece(movedpiece, p0) ^ zobrist_piece(piecetype, p1);
+    this->data.psqt += pst_value(this->data.board_type, piecetype, p1) - pst_value(this->data.board_type, movedpiece, p0);
+    if (nnue_enabled) {
+        nnue_remove(this->data.nnue, this->data.board_type, movedpiece, p0);
+        nnue_add(this->data.nnue, this->data.board_type, piecetype, p1);
+    }
+
+    this->data.board_0[p1] = piecetype;
+    this->data.board_0[p0] = 0;
+#ifdef ROTATED_BOARDS
+    const U8 *const *transforms = rotation_transforms(this->data.board_type);
+    this->data.board_90 [transforms[1][p1]] = piecetype;
+    this->data.board_180[transforms[2][p1]] = piecetype;
+    this->data.board_270[transforms[3][p1]] = piecetype;
 
-    this->data.board_0  [this->data.transform_array[0][p0]] = 0;
-    this->data.board_90 [this->data.transform_array[1][p0]] = 0;
-    this->data.board_180[this->data.transform_array[2][p0]] = 0;
-    this->data.board_270[this->data.transform_array[3][p0]] = 0;
+    this->data.board_90 [transforms[1][p0]] = 0;
+    this->data.board_180[transforms[2][p0]] = 0;
+    this->data.board_270[transforms[3][p0]] = 0;
+#endif
+
+    check_hash(this->data);
 
 }
 
@@ -395,34 +280,56 @@ void Board::undo_last_move_without_flip_(U16 move) {
     U8 deadpiece = this->data.last_killed_piece;
     this->data.last_killed_piece = 0;
 
-    // scan and get piece from coord
+    // look up the moved piece in the piece index, and put back the captured one
     U8 *pieces = (U8*)(&(this->data));
-    for (int i=0; i<2*this->data.n_pieces; i++) {
-        if (pieces[i] == p1) {
-            pieces[i] = p0;
-            break;
-        }
-    }
+    U8 moved_idx = this->data.piece_index[p1];
+    assert(moved_idx != DEAD);
+    check_piece_index(this->data, moved_idx, p1);
+
+    pieces[moved_idx] = p0;
+    this->data.piece_index[p0] = moved_idx;
+    this->data.piece_index[p1] = DEAD;
     if (this->data.last_killed_piece_idx >= 0) {
         pieces[this->data.last_killed_piece_idx] = p1;
+        this->data.piece_index[p1] = this->data.last_killed_piece_idx;
         this->data.last_killed_piece_idx = -1;
     }
 
-    if (promo == PAWN_ROOK) {
-        piecetype = ((piecetype & (WHITE | BLACK)) ^ ROOK) | PAWN;
+    U8 movedpiece = piecetype;
+    if (promo) {
+        piecetype = (piecetype & (WHITE | BLACK)) | PAWN;
     }
-    else if (promo == PAWN_BISHOP) {
-        piecetype = ((piecetype & (WHITE | BLACK)) ^ BISHOP) | PAWN;
+
+    this->data.color_bb[color_idx(color(movedpiece))] ^= sqbit(p0) | sqbit(p1);
+    this->data.piece_bb[piece_idx(movedpiece)] ^= sqbit(p1);
+    this->data.piece_bb[piece_idx(piecetype)] ^= sqbit(p0);
+    this->data.hash ^= zobrist_piece(movedpiece, p1) ^ zobrist_piece(piecetype, p0);
+    this->data.psqt += pst_value(this->data.board_type, piecetype, p0) - pst_value(this->data.board_type, movedpiece, p1);
+    if (nnue_enabled) {
+        nnue_remove(this->data.nnue, this->data.board_type, movedpiece, p1);
+        nnue_add(this->data.nnue, this->data.board_type, piecetype, p0);
     }
+    if (deadpiece) {
+        this->data.color_bb[color_idx(color(deadpiece))] ^= sqbit(p1);
+        this->data.piece_bb[piece_idx(deadpiece)] ^= sqbit(p1);
+        this->data.hash ^= zobrist_piece(deadpiece, p1);
+        this->data.psqt += pst_value(this->data.board_type, deadpiece, p1);
+        if (nnue_enabled) nnue_add(this->data.nnue, this->data.board_type, deadpiece, p1);
+    }
+
+    this->data.board_0[p1] = deadpiece;
+    this->data.board_0[p0] = piecetype;
+#ifdef ROTATED_BOARDS
+    const U8 *const *transforms = rotation_transforms(this->data.board_type);
+    this->data.board_90 [transforms[1][p1]] = deadpiece;
+    this->data.board_180[transforms[2][p1]] = deadpiece;
+    this->data.board_270[transforms[3][p1]] = deadpiece;
 
-    this->data.board_0  [this->data.transform_array[0][p1]] = deadpiece;
-    this->data.board_90 [this->data.transform_array[1][p1]] = deadpiece;
-    this->data.board_180[this->data.transform_array[2][p1]] = deadpiece;
-    this->data.board_270[this->data.transform_array[3][p1]] = deadpiece;
+    this->data.board_90 [transforms[1][p0]] = piecetype;
+    this->data.board_180[transforms[2][p0]] = piecetype;
+    this->data.board_270[transforms[3][p0]] = piecetype;
+#endif
 
-    this->data.board_0  [this->data.transform_array[0][p0]] = piecetype;
-    this->data.board_90 [this->data.transform_array[1][p0]] = piecetype;
-    this->data.board_180[this->data.transform_array[2][p0]] = piecetype;
-    this->data.board_270[this->data.transform_array[3][p0]] = piecetype;
+    check_hash(this->data);
 
 }
@@ -7,6 +7,61 @@
 #include "constants.hpp"
 #include "bdata.hpp"
 
+/**
+ * @brief Fixed-capacity list of moves stored inline.
+ *
+ * Move generation writes into a MoveList instead of returning a fresh
+ * std::unordered_set, so a MoveList declared on the stack lets search code
+ * generate moves without touching the heap. The capacity comfortably exceeds
+ * the largest number of pseudolegal moves a side can have on any of the
+ * Rollerball boards.
+ */
+struct MoveList {
+
+  static const int capacity = 256;
+
+  U16 moves[capacity];
+  int n_moves = 0;
+
+  void push(U16 move) { moves[n_moves++] = move; }
+  void clear() { n_moves = 0; }
+  int size() const { return n_moves; }
+  bool empty() const { return n_moves == 0; }
+
+  U16 &operator[](int i) { return moves[i]; }
+  U16 operator[](int i) const { return moves[i]; }
+
+  U16 *begin() { return moves; }
+  U16 *end() { return moves + n_moves; }
+  const U16 *begin() const { return moves; }
+  const U16 *end() const { return moves + n_moves; }
+
+  /**
+   * @brief Check if the list contains the given move.
+   *
+   * @param move The move to look for.
+   * @return True if the move is present in the list, false otherwise.
+   */
+  bool contains(U16 move) const;
+};
+
+/**
+ * @brief What undo_move_() needs to take back one move made by do_move_().
+ *
+ * The captured piece and its position field can't be recovered from the
+ * board after the move, and the capture record and hash from before the move
+ * are restored as they were.
+ */
+struct UndoRecord {
+
+  U16 move;
+  U8 killed_piece;               /* piece captured by the move, 0 if none */
+  int killed_piece_idx;          /* its position field, -1 if none */
+  U8 prev_last_killed_piece;     /* BoardData::last_killed_piece before the move */
+  int prev_last_killed_piece_idx;
+  U64 prev_hash;
+};
+
 /**
  * @brief Represents the chess board.
  *
@@ -18,6 +73,15 @@ struct Board {
 
   BoardData data; /* The data representing the state of the chess board. */
 
+  /*
+   * Moves made with do_move_(), most recent last. The stack wraps around, so
+   * only the last undo_capacity moves can be taken back; that is far deeper
+   * than any search goes.
+   */
+  static const int undo_capacity = 256;
+  UndoRecord undo_stack[undo_capacity];
+  int n_undo = 0;
+
   /**
    * @brief Default constructor.
    *
@@ -46,7 +110,7 @@ struct Board {
   /**
    * @brief Copy constructor.
    *
-   * Creates a copy of the provided board.
+   * Creates a copy of the provided board, including the moves it can undo.
    *
    * @param source The board object to copy.
    */
@@ -64,6 +128,16 @@ struct Board {
    */
   std::unordered_set<U16> get_legal_moves() const;
 
+  /**
+   * @brief Generate the legal moves for the current board state.
+   *
+   * Allocation-free counterpart of get_legal_moves(). The moves are appended
+   * to the given list, which is not cleared beforehand.
+   *
+   * @param moves The list to which the legal moves are appended.
+   */
+  void generate_legal(MoveList &moves) const;
+
   /**
    * @brief Check if the current player is in check.
    *
@@ -81,10 +155,23 @@ struct Board {
    * state accordingly. After the move is performed, it changes the current
    * player to the opponent.
    *
+   * The move is not validated: it has to be a legal move of the position.
+   * Moves that come from outside the engine (the UI, files) must be checked
+   * against generate_legal() first.
+   *
    * @param move The move to be performed.
    */
   void do_move_(U16 move);
 
+  /**
+   * @brief Undo the last move performed with do_move_().
+   *
+   * Restores the board state from before the move, including the player to
+   * play and the hash. Moves can be undone one after another, back to the
+   * oldest move still on the undo stack.
+   */
+  void undo_move_();
+
   /**
    * @brief Get the pseudolegal moves for the current board state.
    *
@@ -97,6 +184,16 @@ struct Board {
    */
   std::unordered_set<U16> get_pseudolegal_moves() const;
 
+  /**
+   * @brief Generate the pseudolegal moves for the current board state.
+   *
+   * Allocation-free counterpart of get_pseudolegal_moves(). The moves are
+   * appended to the given list, which is not cleared beforehand.
+   *
+   * @param moves The list to which the pseudolegal moves are appended.
+   */
+  void generate_pseudolegal(MoveList &moves) const;
+
   /**
    * @brief Get the pseudolegal moves for a specific piece on the board.
    *
@@ -109,6 +206,16 @@ struct Board {
    */
   std::unordered_set<U16> get_pseudolegal_moves_for_piece(U8 piece_pos) const;
 
+  /**
+   * @brief Generate the pseudolegal moves for a specific piece on the board.
+   *
+   * Allocation-free counterpart of get_pseudolegal_moves_for_piece().
+   *
+   * @param piece_pos The position of the piece on the board.
+   * @param moves The list to which the pseudolegal moves are appended.
+   */
+  void generate_pseudolegal_for_piece(U8 piece_pos, MoveList &moves) const;
+
   /**
    * @brief Flip the current player.
    *
@@ -117,6 +224,28 @@ struct Board {
    */
   void flip_player_();
 
+  /**
+   * @brief Get the Zobrist hash of the current position.
+   *
+   * The hash covers the pieces, the player to play and the board type, and
+   * is maintained incrementally as moves are made and undone.
+   *
+   * @return The 64-bit hash of the current position.
+   */
+  U64 hash() const;
+
+  /**
+   * @brief Count the earlier occurrences of the current position.
+   *
+   * Looks back through the moves on the undo stack, so a board that has been
+   * played from the start position knows the positions of the game so far
+   * (up to undo_capacity moves back). The scan stops at the last capture or
+   * promotion, since no earlier position can come back after one.
+   *
+   * @return The number of times the current position occurred before.
+   */
+  int repetitions() const;
+
   /**
    * @brief Perform a move on the board without flipping the current player.
    *
@@ -138,6 +267,34 @@ struct Board {
    */
   bool under_threat(U8 piece_pos) const;
 
+  /**
+   * @brief Check if a square is attacked by the pieces of the given color.
+   *
+   * Rather than generating the moves of every piece of that color, this looks
+   * up which squares a piece could reach the square from and only walks the
+   * rays of the sliders found there. Whatever stands on the square itself is
+   * ignored.
+   *
+   * @param sq The square to test.
+   * @param by_color The color of the attacking side.
+   * @return True if a piece of by_color can move to sq, false otherwise.
+   */
+  bool is_square_attacked(U8 sq, U8 by_color) const;
+
+  /**
+   * @brief Static exchange evaluation of a move.
+   *
+   * Plays out the exchange on the move's target square, with both sides
+   * recapturing with their least valuable piece and stopping when going on
+   * would lose material. Sliders hidden behind other pieces, on straight or
+   * reflected rays, join the exchange once the pieces in front have taken.
+   *
+   * @param move A pseudolegal move of the player to play, usually a capture.
+   * @return The material the player to play wins (or loses, if negative) in
+   * centipawns.
+   */
+  int see(U16 move) const;
+
   /**
    * @brief Undo the last move on the board without flipping the current
    * player.
@@ -163,4 +320,14 @@ struct Board {
    * current board state.
    */
   std::unordered_set<U16> get_pseudolegal_moves_for_side(U8 color) const;
+
+  /**
+   * @brief Generate the pseudolegal moves for a specific side (color).
+   *
+   * Allocation-free counterpart of get_pseudolegal_moves_for_side().
+   *
+   * @param color The color of the side for which to generate the moves.
+   * @param moves The list to which the pseudolegal moves are appended.
+   */
+  void generate_pseudolegal_for_side(U8 color, MoveList &moves) const;
 };
@@ -128,7 +128,13 @@ std::string move_to_str(U16 move) {
 }
 
 U16 str_to_move(std::string move) {
-    
+
+    // a malformed move is read as the null move, which is never legal
+    if (move.size() < 4 || move.size() > 5) return 0;
+    for (int i=0; i<4; i+=2) {
+        if (move[i] < 'a' || move[i] > 'h' || move[i+1] < '1' || move[i+1] > '8') return 0;
+    }
+
     U8 x0 = move[0] - 'a';
     U8 y0 = move[1] - '1';
     U8 x1 = move[2] - 'a';
@@ -136,8 +142,23 @@ U16 str_to_move(std::string move) {
     U8 promo = 0;
     if (move.size() > 4) {
         if (move[4] == 'r') promo = PAWN_ROOK;
-        else promo = PAWN_BISHOP;
+        else if (move[4] == 'b') promo = PAWN_BISHOP;
+        else return 0;
     }
 
     return move_promo(pos(x0,y0), pos(x1,y1), promo);
 }
+
+bool parse_board_type(const std::string& name, BoardType& btype) {
+    if      (name == "board-7-3" || name == "7_3") btype = SEVEN_THREE;
+    else if (name == "board-8-4" || name == "8_4") btype = EIGHT_FOUR;
+    else if (name == "board-8-2" || name == "8_2") btype = EIGHT_TWO;
+    else return false;
+    return true;
+}
+
+std::string board_type_to_str(BoardType btype) {
+    if (btype == SEVEN_THREE) return "board-7-3";
+    if (btype == EIGHT_FOUR)  return "board-8-4";
+    return "board-8-2";
+}
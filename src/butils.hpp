@@ -16,7 +16,8 @@ std::string move_to_str(U16 move);
 /**
 * This function is used to convert a move in string format to U16 format.
 * @param move which is a parameter of type string representing a move.
-* @return a Move type representing the move in U16 datatype. 
+* @return a Move type representing the move in U16 datatype, or 0 (the null
+* move) if the string is not a move.
 */
 U16 str_to_move(std::string move);
 
@@ -65,3 +66,17 @@ std::string board_to_str(const BoardData *b);
 */
 std::string board_7_3_to_str(const U8 *b);
 
+/**
+ * This function is used to parse a board type name as used by the UI
+ * (board-7-3, board-8-4, board-8-2) or its short form (7_3, 8_4, 8_2).
+ * @param name the name to parse and btype the board type it names.
+ * @return true if the name is a known board type.
+ */
+bool parse_board_type(const std::string& name, BoardType& btype);
+
+/**
+ * This function is used to convert a board type to the name used by the UI.
+ * @param btype the board type.
+ * @return the name of the board type, such as board-7-3.
+ */
+std::string board_type_to_str(BoardType btype);
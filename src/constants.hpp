@@ -4,6 +4,7 @@
 
 typedef uint8_t U8;
 typedef uint16_t U16;
+typedef uint64_t U64;
 
 #define pos(x,y) (((y)<<3)|(x))
 #define gety(p)  ((p)>>3)
@@ -22,6 +23,18 @@ typedef uint16_t U16;
 #define occupied(b, p, c) (b[(p)] & (c))
 #define inboard(b, x, y) (((x) <= 7) && ((x) >= 0) && ((y) <= 7) && ((y) >= 0) && (b[pos((x),(y))] != 1))
 
+#define sqbit(p) (((U64)1)<<(p))
+#define color_idx(c) ((c)>>7)
+#define piece_idx(p) (__builtin_ctz((p) & 0x3e))
+#define pop_lsb(bb) ((bb) &= (bb)-1)
+#define lsb(bb) ((U8)__builtin_ctzll(bb))
+#define popcount(bb) (__builtin_popcountll(bb))
+
+// Material values of the pieces, indexed by piece_idx: pawn, rook, king,
+// bishop, knight. The king has no material value. The evaluation, move
+// ordering and exchange evaluation all start from this table.
+constexpr int piece_values[6] = {0, 100, 500, 0, 330, 300};
+
 constexpr U8 cw_90_7x7[64] = {
     48, 40, 32, 24, 16, 8,  0,  7,
     49, 41, 33, 25, 17, 9,  1,  15,
@@ -143,6 +156,41 @@ constexpr U8 board_8_4[64] = {
     4, 4, 4, 4, 4, 4, 4, 5
 };
 
+// Bitboards derived from the board masks above. quadrant_mask selects the
+// squares of one quadrant (mask values 2 to 5).
+constexpr U64 board_mask_bb(const U8 *mask) {
+    U64 bb = 0;
+    for (int i=0; i<64; i++) {
+        if (mask[i] != 1) bb |= sqbit(i);
+    }
+    return bb;
+}
+
+constexpr U64 quadrant_mask(const U8 *mask, U8 quadrant) {
+    U64 bb = 0;
+    for (int i=0; i<64; i++) {
+        if (mask[i] == quadrant) bb |= sqbit(i);
+    }
+    return bb;
+}
+
+constexpr U64 bb_7_3 = board_mask_bb(board_7_3);
+constexpr U64 bb_8_2 = board_mask_bb(board_8_2);
+constexpr U64 bb_8_4 = board_mask_bb(board_8_4);
+
+constexpr U64 quadrants_7_3[4] = {
+    quadrant_mask(board_7_3, 2), quadrant_mask(board_7_3, 3),
+    quadrant_mask(board_7_3, 4), quadrant_mask(board_7_3, 5)
+};
+constexpr U64 quadrants_8_2[4] = {
+    quadrant_mask(board_8_2, 2), quadrant_mask(board_8_2, 3),
+    quadrant_mask(board_8_2, 4), quadrant_mask(board_8_2, 5)
+};
+constexpr U64 quadrants_8_4[4] = {
+    quadrant_mask(board_8_4, 2), quadrant_mask(board_8_4, 3),
+    quadrant_mask(board_8_4, 4), quadrant_mask(board_8_4, 5)
+};
+
 // Let's not do this now. Loading / storing from a string config will become too 
 // complex
 // const char* board_7_3_startconfig = R"BOARD(
@@ -1,39 +1,199 @@
 #include <algorithm>
-#include <random>
+#include <deque>
 #include <iostream>
+#include <sstream>
 #include <thread>
+#include <vector>
 
+#include "threadpool.hpp"
 #include "board.hpp"
 #include "engine.hpp"
 #include "butils.hpp"
+#include "search.hpp"
+#include "movegen.hpp"
+#include "timeman.hpp"
+
+std::string score_to_str(int score) {
+    if (is_mate_score(score)) {
+        int plies = MATE_SCORE - std::abs(score);
+        return "mate " + std::to_string(score > 0 ? (plies + 1) / 2 : -(plies + 1) / 2);
+    }
+    return "cp " + std::to_string(score);
+}
+
+// Lazy SMP helper: searches the same root as the main thread until told to
+// stop. Odd helpers start one ply deeper, so that the threads are spread over
+// two depths and fill the shared table with different parts of the tree.
+template <BoardType BT>
+void helper_search(Searcher<BT> *searcher, int id) {
+
+    for (int depth = 1 + (id & 1); depth < MAX_PLY; depth++) {
+        searcher->search_root(depth, -INF_SCORE, INF_SCORE);
+        if (searcher->stop->load(std::memory_order_relaxed)) break;
+    }
+}
+
+void Engine::set_board_type(BoardType btype) {
+
+    this->search_type = btype;
+    this->search_fn = with_layout(btype, [](auto layout) {
+        return &Engine::search<decltype(layout)::type>;
+    });
+}
+
+void Engine::start_clock(const Board& b) {
+
+    auto now = std::chrono::steady_clock::now();
+    if (this->limits.movetime.count() > 0) {
+        this->soft_deadline = now + this->limits.movetime;
+        this->deadline = now + this->limits.movetime;
+    }
+    else if (this->limits.infinite || this->limits.depth > 0 || this->limits.nodes > 0) {
+        this->soft_deadline = std::chrono::steady_clock::time_point::max();
+        this->deadline = std::chrono::steady_clock::time_point::max();
+    }
+    else {
+        TimeBudget budget = compute_time_budget(this->time_left, b);
+        this->soft_deadline = now + budget.soft;
+        this->deadline = now + budget.hard;
+    }
+}
+
+void Engine::ponderhit(const Board& b, const SearchLimits& limits, std::chrono::milliseconds time_left) {
+
+    // the search only reads the limits and the clock once it sees that
+    // pondering is over, so they are in place before the flag drops
+    this->limits = limits;
+    this->time_left = time_left;
+    this->start_clock(b);
+    this->pondering = false;
+}
 
 void Engine::find_best_move(const Board& b) {
 
-    // pick a random move
-    
-    auto moveset = b.get_legal_moves();
-    if (moveset.size() == 0) {
+    MoveList legal_moves;
+    b.generate_legal(legal_moves);
+    if (legal_moves.empty()) {
         std::cout << "Could not get any moves from board!\n";
         std::cout << board_to_str(&b.data);
         this->best_move = 0;
+        return;
+    }
+    this->best_move = legal_moves[0];
+    this->ponder_move = 0;
+
+    if (this->tt == nullptr) {
+        static TranspositionTable default_tt;
+        this->tt = &default_tt;
+    }
+    this->tt->new_search();
+
+    if (this->search_fn == nullptr || this->search_type != b.data.board_type) {
+        this->set_board_type(b.data.board_type);
+    }
+    (this->*search_fn)(b, legal_moves);
+}
+
+template <BoardType BT>
+void Engine::search(const Board& b, const MoveList& legal_moves) {
+
+    auto start = std::chrono::steady_clock::now();
+
+    // while pondering the limits belong to the next go command, which
+    // ponderhit() hands over; they are applied once pondering is over
+    bool limits_applied = !this->pondering;
+    if (limits_applied) {
+        this->start_clock(b);
     }
     else {
-        std::vector<U16> moves;
-        std::cout << show_moves(&b.data, moveset) << std::endl;
-        for (auto m : moveset) {
-            std::cout << move_to_str(m) << " ";
+        this->soft_deadline = std::chrono::steady_clock::time_point::max();
+        this->deadline = std::chrono::steady_clock::time_point::max();
+    }
+    // the searchers stop on search_over, which they raise themselves at the
+    // limits and on seeing the stop flag
+    this->search_over = false;
+    Searcher<BT> searcher(b, this->tt, &this->search_over);
+    searcher.abort = &this->stop;
+    searcher.deadline = &this->deadline;
+    if (limits_applied) searcher.node_limit = this->limits.nodes;
+
+    // helpers only watch the stop flag, the main thread keeps the clock
+    std::deque<Searcher<BT>> helpers;
+    std::vector<std::thread> helper_threads;
+    WaitGroup helpers_done;
+    for (int i=1; i<this->n_threads && legal_moves.size() > 1; i++) {
+        helpers.emplace_back(b, this->tt, &this->search_over);
+        helpers.back().abort = &this->stop;
+    }
+    helpers_done.add((int)helpers.size());
+    for (size_t i=0; i<helpers.size(); i++) {
+        if (this->pool != nullptr) {
+            this->pool->submit([&helpers, &helpers_done, i]() {
+                helper_search<BT>(&helpers[i], (int)i+1);
+                helpers_done.done();
+            });
         }
-        std::cout << std::endl;
-        std::sample(
-            moveset.begin(),
-            moveset.end(),
-            std::back_inserter(moves),
-            1,
-            std::mt19937{std::random_device{}()}
-        );
-        this->best_move = moves[0];
-    }
-
-    // just for debugging, to slow down the moves
-    std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+        else {
+            helper_threads.emplace_back([&helpers, &helpers_done, i]() {
+                helper_search<BT>(&helpers[i], (int)i+1);
+                helpers_done.done();
+            });
+        }
+    }
+
+    // iterative deepening: each iteration is ordered by the hash moves left
+    // behind by the previous one, and only completed iterations count
+    for (int depth = 1; depth < MAX_PLY; depth++) {
+
+        if (!limits_applied && !this->pondering) {
+            searcher.node_limit = this->limits.nodes;
+            limits_applied = true;
+        }
+        if (limits_applied && this->limits.depth > 0 && depth > this->limits.depth) break;
+
+        int score = searcher.search_root(depth, -INF_SCORE, INF_SCORE);
+        if (this->search_over || this->stop) break;
+
+        if (searcher.pv_len[0] > 0) {
+            this->best_move = searcher.pv[0][0];
+            this->ponder_move = searcher.pv_len[0] > 1 ? searcher.pv[0][1] : 0;
+        }
+
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+        uint64_t nodes = searcher.nodes;
+        for (auto &h : helpers) nodes += h.nodes;
+
+        std::ostringstream info;
+        info << "info depth " << depth << " seldepth " << searcher.seldepth
+             << " score " << score_to_str(score) << " nodes " << nodes
+             << " nps " << (ms > 0 ? nodes * 1000 / ms : nodes)
+             << " hashfull " << this->tt->hashfull()
+             << " time " << ms << " pv";
+        for (int i=0; i<searcher.pv_len[0]; i++) info << " " << move_to_str(searcher.pv[0][i]);
+        if (this->print_info) std::cout << info.str() << std::endl;
+
+        if (legal_moves.size() == 1 || is_mate_score(score)) break;
+
+        // the next iteration takes several times as long as this one, so
+        // don't start it once the soft limit has passed
+        if (std::chrono::steady_clock::now() >= this->soft_deadline.load()) break;
+    }
+
+    // a search that is done early while pondering, or in infinite mode,
+    // still has to wait for the opponent's move or stop before it may answer
+    while ((this->pondering || this->limits.infinite) && !this->stop) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    this->search_over = true;
+    helpers_done.wait();
+    for (auto &t : helper_threads) t.join();
+
+    if (!helpers.empty() && this->print_info) {
+        std::ostringstream info;
+        info << "info string thread nodes " << searcher.nodes;
+        for (auto &h : helpers) info << " " << h.nodes;
+        std::cout << info.str() << std::endl;
+    }
 }
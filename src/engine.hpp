@@ -1,7 +1,21 @@
 #pragma once
 
-#include "engine_base.hpp"
 #include <atomic>
+#include "engine_base.hpp"
+#include "tt.hpp"
+
+class ThreadPool;
+
+/**
+ * Limits of one search, as given with the go command. With none of them set
+ * the search keeps the clock in time_left.
+ */
+struct SearchLimits {
+    std::chrono::milliseconds movetime{0};
+    int depth = 0;
+    uint64_t nodes = 0;
+    bool infinite = false;
+};
 
 class Engine : public AbstractEngine {
 
@@ -10,6 +24,80 @@ class Engine : public AbstractEngine {
     // constructor.
     
     public:
+
+    // Owned by the server: persists across find_best_move calls within a
+    // game and is cleared when a new game starts. Engines created without a
+    // server share a default table.
+    TranspositionTable *tt = nullptr;
+
+    // Raised by the server to abort the search; the best move of the last
+    // completed iteration is kept. Only the server lowers it again, once the
+    // search has finished: a search started while it is raised answers at
+    // once.
+    std::atomic<bool> stop{false};
+
+    // Set while searching the position after the reply we expect, before
+    // the opponent has played it: the search ignores the clock and does not
+    // return until ponderhit() or the stop flag.
+    std::atomic<bool> pondering{false};
+
+    // The reply expected to best_move, from the principal variation, or 0.
+    U16 ponder_move = 0;
+
+    // Limits of the next search; an infinite search, like a pondering one,
+    // only returns once the stop flag is raised. Like time_left, they are
+    // only assigned while no search runs: a pondering search gets the ones
+    // of the go command through ponderhit().
+    SearchLimits limits;
+
+    // Number of threads searching each move. Helper threads run a Lazy SMP
+    // search that shares the transposition table with the main thread.
+    int n_threads = 1;
+
+    // Owned by the server: persistent workers the helper threads run on.
+    // Engines created without a server start a thread per helper instead.
+    ThreadPool *pool = nullptr;
+
+    // Print an info line per iteration. Off when many games are played in
+    // one process, as by the match runner.
+    bool print_info = true;
+
     void find_best_move(const Board& b) override;
 
+    /**
+     * Picks the search compiled for the given board layout. The server calls
+     * this when a game starts; find_best_move calls it itself if the board
+     * it is given has another layout.
+     */
+    void set_board_type(BoardType btype);
+
+    /**
+     * The opponent played the expected reply: the pondering search becomes
+     * the search for our move and from now on keeps to the limits of the go
+     * command. The limits are handed over here rather than assigned, since
+     * the search is running.
+     * @param b - the position being searched.
+     * @param limits - the limits of the go command.
+     * @param time_left - our clock.
+     */
+    void ponderhit(const Board& b, const SearchLimits& limits, std::chrono::milliseconds time_left);
+
+    private:
+
+    // When the search stops starting new iterations, and when it is aborted.
+    std::atomic<std::chrono::steady_clock::time_point> soft_deadline;
+    std::atomic<std::chrono::steady_clock::time_point> deadline;
+
+    // Raised by the main thread at the limits, or once it has answered, to
+    // stop the helper threads; the engine's own counterpart of stop.
+    std::atomic<bool> search_over{false};
+
+    void start_clock(const Board& b);
+
+    void (Engine::*search_fn)(const Board& b, const MoveList& legal_moves) = nullptr;
+    BoardType search_type = SEVEN_THREE;
+
+    template <BoardType BT>
+    void search(const Board& b, const MoveList& legal_moves);
+
 };
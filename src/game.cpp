@@ -0,0 +1,44 @@
+#include <ostream>
+
+#include "board.hpp"
+#include "game.hpp"
+
+GameStatus game_status(const Board& b, int max_plies) {
+
+    MoveList moves;
+    b.generate_legal(moves);
+    if (moves.empty()) return b.in_check() ? GAME_CHECKMATE : GAME_STALEMATE;
+    if (b.repetitions() >= 2) return GAME_REPETITION;
+    if (max_plies > 0 && b.n_undo >= max_plies) return GAME_MOVE_LIMIT;
+    return GAME_ONGOING;
+}
+
+const char *game_status_to_str(GameStatus status) {
+    switch (status) {
+        case GAME_CHECKMATE:  return "checkmate";
+        case GAME_STALEMATE:  return "stalemate";
+        case GAME_REPETITION: return "repetition";
+        case GAME_MOVE_LIMIT: return "move limit";
+        default:              return "ongoing";
+    }
+}
+
+void Score::add(double points) {
+    if (points == 1) this->wins++;
+    else if (points == 0) this->losses++;
+    else this->draws++;
+}
+
+int Score::games() const {
+    return this->wins + this->draws + this->losses;
+}
+
+double Score::mean() const {
+    return this->games() ? (this->wins + 0.5 * this->draws) / this->games() : 0;
+}
+
+std::ostream& operator<<(std::ostream& os, const Score& s) {
+    os << "+" << s.wins << " =" << s.draws << " -" << s.losses
+       << " (" << s.games() << " games, " << (int)(s.mean() * 1000) / 10.0 << "%)";
+    return os;
+}
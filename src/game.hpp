@@ -0,0 +1,53 @@
+#pragma once
+
+#include <ostream>
+#include "board.hpp"
+
+/**
+ * How a game stands after a move. Everything but GAME_ONGOING ends it:
+ * checkmate is a loss for the side to move, the others are draws.
+ */
+enum GameStatus {
+    GAME_ONGOING,
+    GAME_CHECKMATE,
+    GAME_STALEMATE,
+    GAME_REPETITION,
+    GAME_MOVE_LIMIT
+};
+
+/**
+ * @brief Adjudicates a position, the way the UI would: the side to move has
+ * no legal moves (checkmate or stalemate), the position occurred for the
+ * third time, or the game reached its ply limit.
+ * @param b - the position, played from the start position with do_move_()
+ * so that it knows the earlier positions of the game.
+ * @param max_plies - the ply limit, or 0 for none.
+ * @return the status of the game.
+ */
+GameStatus game_status(const Board& b, int max_plies);
+
+/**
+ * @return a short name for the status, such as "checkmate".
+ */
+const char *game_status_to_str(GameStatus status);
+
+/**
+ * Wins, draws and losses of one side over a series of games.
+ */
+struct Score {
+    int wins = 0, draws = 0, losses = 0;
+
+    /**
+     * @param points - the points of one game: 1, 0.5 or 0.
+     */
+    void add(double points);
+
+    int games() const;
+
+    /**
+     * @return the points per game, between 0 and 1.
+     */
+    double mean() const;
+};
+
+std::ostream& operator<<(std::ostream& os, const Score& s);
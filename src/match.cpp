@@ -0,0 +1,193 @@
+#include <popl.hpp>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "board.hpp"
+#include "butils.hpp"
+#include "engine.hpp"
+#include "game.hpp"
+#include "nnue.hpp"
+#include "pst.hpp"
+
+// One side of the match. Each keeps its own transposition table, cleared
+// before every game, so the two engines share nothing but the evaluation.
+struct Player {
+    std::string name;
+    TranspositionTable tt;
+    int n_threads = 1;
+};
+
+// Clock and search limits, the same for both players.
+struct TimeControl {
+    int time_ms = 10000;
+    int inc_ms = 0;
+    int depth = 0;
+    uint64_t nodes = 0;
+
+    // with a depth or node limit the clock is kept, but never runs out
+    bool timed() const { return this->depth == 0 && this->nodes == 0; }
+};
+
+// Plays one game, with players[first] as white, and returns the points scored
+// by players[0]. Every move is logged as a CSV line if a log is given.
+double play_game(Player players[2], int first, BoardType btype, const TimeControl& tc,
+                 int max_plies, int game_no, std::ostream *log) {
+
+    Engine engines[2];
+    for (int i=0; i<2; i++) {
+        players[i].tt.clear();
+        engines[i].tt = &players[i].tt;
+        engines[i].n_threads = players[i].n_threads;
+        engines[i].limits.depth = tc.depth;
+        engines[i].limits.nodes = tc.nodes;
+        engines[i].print_info = false;
+        engines[i].set_board_type(btype);
+    }
+
+    // indexed by color_idx
+    int player_of[2] = {first, first ^ 1};
+    int clock_ms[2] = {tc.time_ms, tc.time_ms};
+
+    Board b(btype);
+    GameStatus status;
+    std::string reason;
+    int winner = -1;
+    while ((status = game_status(b, max_plies)) == GAME_ONGOING) {
+
+        int side = color_idx(b.data.player_to_play);
+        Engine &e = engines[player_of[side]];
+        e.time_left = std::chrono::milliseconds(clock_ms[side]);
+
+        auto start = std::chrono::steady_clock::now();
+        e.find_best_move(b);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        int ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+        clock_ms[side] -= ms;
+
+        if (log != nullptr) {
+            *log << game_no << "," << board_type_to_str(btype) << "," << b.n_undo + 1 << ","
+                 << (side == color_idx(WHITE) ? "white" : "black") << ","
+                 << players[player_of[side]].name << "," << move_to_str(e.best_move) << ","
+                 << ms << "," << clock_ms[side] << "\n";
+        }
+
+        if (tc.timed() && clock_ms[side] < 0) {
+            winner = player_of[side ^ 1];
+            reason = "time forfeit";
+            break;
+        }
+        MoveList legal;
+        b.generate_legal(legal);
+        if (!legal.contains(e.best_move)) {
+            winner = player_of[side ^ 1];
+            reason = "illegal move " + move_to_str(e.best_move);
+            break;
+        }
+
+        clock_ms[side] += tc.inc_ms;
+        b.do_move_(e.best_move);
+    }
+
+    if (status == GAME_CHECKMATE) {
+        winner = player_of[color_idx(b.data.player_to_play) ^ 1];
+    }
+    if (reason.empty()) reason = game_status_to_str(status);
+
+    const char *result = winner < 0 ? "1/2-1/2" : winner == first ? "1-0" : "0-1";
+    std::cout << "game " << game_no << " " << board_type_to_str(btype) << ": "
+              << players[first].name << " - " << players[first ^ 1].name << " " << result
+              << " (" << reason << ", " << b.n_undo << " plies)" << std::endl;
+
+    return winner < 0 ? 0.5 : winner == 0 ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+
+    popl::OptionParser op("Rollerball match");
+    std::string type_str, log_path, pst_file, eval_file;
+    int n_games, max_plies;
+    size_t hash_mb;
+    Player players[2];
+    TimeControl tc;
+    auto help_op = op.add<popl::Switch>("h", "help", "produce help message");
+    op.add<popl::Value<std::string>>("t", "type", "board type (board-7-3, board-8-4, board-8-2 or all)", "all", &type_str);
+    op.add<popl::Value<int>>("n", "games", "number of games per board type", 10, &n_games);
+    op.add<popl::Value<int>>("", "time", "time per side per game in ms", 10000, &tc.time_ms);
+    op.add<popl::Value<int>>("", "inc", "increment per move in ms", 0, &tc.inc_ms);
+    op.add<popl::Value<int>>("", "depth", "search each move to a fixed depth instead", 0, &tc.depth);
+    op.add<popl::Value<uint64_t>>("", "nodes", "search each move for a number of nodes instead", 0, &tc.nodes);
+    op.add<popl::Value<int>>("", "max-plies", "adjudicate a draw after this many plies (0 for none)", 300, &max_plies);
+    op.add<popl::Value<size_t>>("", "hash", "transposition table size in MB per engine", 16, &hash_mb);
+    op.add<popl::Value<int>>("", "threads-a", "number of search threads of engine A", 1, &players[0].n_threads);
+    op.add<popl::Value<int>>("", "threads-b", "number of search threads of engine B", 1, &players[1].n_threads);
+    op.add<popl::Value<std::string>>("", "log", "write every move and its time to a CSV file", "", &log_path);
+    op.add<popl::Value<std::string>>("", "pst-file", "load the piece-square tables from a file", "", &pst_file);
+    op.add<popl::Value<std::string>>("", "eval-file", "load a neural network to evaluate with", "", &eval_file);
+    op.parse(argc, argv);
+
+    if (help_op->is_set()) {
+        std::cout << op << std::endl;
+        return 0;
+    }
+
+    std::vector<BoardType> btypes;
+    if (type_str == "all") {
+        btypes = {SEVEN_THREE, EIGHT_FOUR, EIGHT_TWO};
+    }
+    else {
+        BoardType btype;
+        if (!parse_board_type(type_str, btype)) {
+            std::cout << "ERROR: unknown board type " << type_str << std::endl;
+            return 1;
+        }
+        btypes = {btype};
+    }
+
+    if (players[0].n_threads < 1 || players[1].n_threads < 1) {
+        std::cout << "ERROR: at least one search thread is needed" << std::endl;
+        return 1;
+    }
+
+    if (!pst_file.empty() && !load_pst_file(pst_file)) return 1;
+    if (!eval_file.empty() && !load_nnue_file(eval_file)) return 1;
+
+    std::ofstream log;
+    if (!log_path.empty()) {
+        log.open(log_path);
+        if (!log) {
+            std::cout << "ERROR: could not open " << log_path << std::endl;
+            return 1;
+        }
+        log << "game,board,ply,side,engine,move,time_ms,clock_ms\n";
+    }
+
+    players[0].name = "A";
+    players[1].name = "B";
+    for (auto &p : players) p.tt.resize(hash_mb);
+
+    // A's score, per board type and overall
+    Score total;
+    std::vector<Score> per_type(btypes.size());
+    int game_no = 0;
+    for (size_t t=0; t<btypes.size(); t++) {
+        for (int g=0; g<n_games; g++) {
+            // the engines take turns playing white
+            double points = play_game(players, g % 2, btypes[t], tc, max_plies, ++game_no,
+                                      log.is_open() ? &log : nullptr);
+            per_type[t].add(points);
+            total.add(points);
+        }
+    }
+
+    std::cout << "\nResults for A:\n";
+    for (size_t t=0; t<btypes.size(); t++) {
+        std::cout << "  " << board_type_to_str(btypes[t]) << ": " << per_type[t] << "\n";
+    }
+    std::cout << "  total: " << total << std::endl;
+
+    return 0;
+}
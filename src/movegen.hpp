@@ -0,0 +1,393 @@
+#pragma once
+
+#include <algorithm>
+#include "board.hpp"
+
+// Move generation specialised per board layout. A game never changes layout,
+// so the ray tables, promotion squares and quadrants of each layout are
+// compile-time constants here rather than pointers read out of BoardData. The
+// Board member functions pick the specialisation from data.board_type, and
+// the search picks it once per move.
+
+constexpr U64 promo_squares_bb(const U8 *transform, int n_promo_squares) {
+
+    U64 bb = 0;
+    for (int i=0; i<n_promo_squares; i++) bb |= sqbit(transform[pos(2, i)]);
+    return bb;
+}
+
+/**
+ * The constant geometry of one board layout. The pawn promotion bitboards
+ * are indexed by color_idx and hold the squares a pawn promotes on and the
+ * quadrant it has to step onto them from: white pawns promote in the top
+ * quadrant, black pawns in the bottom one.
+ */
+template <BoardType BT> struct Layout;
+
+template <> struct Layout<SEVEN_THREE> {
+    static constexpr BoardType type = SEVEN_THREE;
+    static constexpr const RayTable &rays = rays_7_3;
+    static constexpr U64 board_bb = bb_7_3;
+    static constexpr U64 pawn_promo_bb[2] = {promo_squares_bb(cw_180_7x7, 2), promo_squares_bb(id_7x7, 2)};
+    static constexpr U64 pawn_promo_from_bb[2] = {quadrants_7_3[2], quadrants_7_3[0]};
+};
+
+template <> struct Layout<EIGHT_FOUR> {
+    static constexpr BoardType type = EIGHT_FOUR;
+    static constexpr const RayTable &rays = rays_8_4;
+    static constexpr U64 board_bb = bb_8_4;
+    static constexpr U64 pawn_promo_bb[2] = {promo_squares_bb(cw_180_8x8, 2), promo_squares_bb(id_8x8, 2)};
+    static constexpr U64 pawn_promo_from_bb[2] = {quadrants_8_4[2], quadrants_8_4[0]};
+};
+
+template <> struct Layout<EIGHT_TWO> {
+    static constexpr BoardType type = EIGHT_TWO;
+    static constexpr const RayTable &rays = rays_8_2;
+    static constexpr U64 board_bb = bb_8_2;
+    static constexpr U64 pawn_promo_bb[2] = {promo_squares_bb(cw_180_8x8, 3), promo_squares_bb(id_8x8, 3)};
+    static constexpr U64 pawn_promo_from_bb[2] = {quadrants_8_2[2], quadrants_8_2[0]};
+};
+
+// Rooks and bishops walk the precomputed rays of their square up to the first
+// blocker. A reflected ray can cross a square the piece already reaches (this
+// happens on the 8_2 board), so targets are gathered in a bitboard first.
+inline U64 slider_targets(const SliderRays& rays, U64 own, U64 opp) {
+
+    U64 targets = 0;
+    int i = 0;
+    for (int r=0; r<rays.n_rays; r++) {
+        for (; i<rays.ray_end[r]; i++) {
+            U8 tgt_pos = rays.squares[i];
+            if (own & sqbit(tgt_pos)) break;
+
+            targets |= sqbit(tgt_pos);
+            if (opp & sqbit(tgt_pos)) break;
+        }
+        i = rays.ray_end[r];
+    }
+    return targets;
+}
+
+inline void construct_slider_moves(const U8 p0, const SliderRays& rays, U64 own, U64 opp,
+        U64 mask, MoveList& slider_moves) {
+
+    for (U64 targets = slider_targets(rays, own, opp) & mask; targets; pop_lsb(targets)) {
+        slider_moves.push(move(p0, lsb(targets)));
+    }
+}
+
+// Kings, knights and pawns step to the squares of their precomputed mask that
+// aren't held by their own side.
+inline void construct_step_moves(const U8 p0, U64 targets, MoveList& step_moves) {
+
+    for (; targets; pop_lsb(targets)) {
+        step_moves.push(move(p0, lsb(targets)));
+    }
+}
+
+// A pawn promotes when it steps onto one of its side's promotion squares
+// from inside the promoting quadrant, and can become either a rook or a bishop.
+inline void construct_pawn_moves(const U8 p0, U64 targets, U64 promo_targets,
+        MoveList& pawn_moves) {
+
+    for (U64 bb = targets & ~promo_targets; bb; pop_lsb(bb)) {
+        pawn_moves.push(move(p0, lsb(bb)));
+    }
+    for (U64 bb = targets & promo_targets; bb; pop_lsb(bb)) {
+        pawn_moves.push(move_promo(p0, lsb(bb), PAWN_ROOK));
+        pawn_moves.push(move_promo(p0, lsb(bb), PAWN_BISHOP));
+    }
+}
+
+/**
+ * Which moves to generate: all of them, only captures and promotions (the
+ * moves that change material), or only the remaining quiet moves.
+ */
+enum GenType {
+    GEN_ALL,
+    GEN_NOISY,
+    GEN_QUIET
+};
+
+template <BoardType BT, GenType GT = GEN_ALL>
+void generate_piece_moves(const BoardData& d, U8 piece_pos, MoveList& moves) {
+
+    typedef Layout<BT> L;
+    U8 piece_id = d.board_0[piece_pos];
+    int c = color_idx(color(piece_id));
+    U64 own = d.color_bb[c];
+    U64 opp = d.color_bb[c ^ 1];
+    U64 mask = GT == GEN_ALL ? ~own : GT == GEN_NOISY ? opp : ~(own | opp);
+
+    if (piece_id & PAWN) {
+        U64 promo_targets = (L::pawn_promo_from_bb[c] & sqbit(piece_pos)) ? L::pawn_promo_bb[c] : 0;
+        // promotions count as noisy whether or not they capture
+        if (GT == GEN_NOISY) mask = (opp | promo_targets) & ~own;
+        if (GT == GEN_QUIET) mask &= ~promo_targets;
+        construct_pawn_moves(piece_pos, L::rays.pawn[piece_pos] & mask, promo_targets, moves);
+    }
+    else if (piece_id & ROOK) {
+        construct_slider_moves(piece_pos, L::rays.rook[piece_pos], own, opp, mask, moves);
+    }
+    else if (piece_id & BISHOP) {
+        construct_slider_moves(piece_pos, L::rays.bishop[piece_pos], own, opp, mask, moves);
+    }
+    else if (piece_id & KING) {
+        construct_step_moves(piece_pos, L::rays.king[piece_pos] & mask, moves);
+    }
+    else if (piece_id & KNIGHT) {
+        construct_step_moves(piece_pos, L::rays.knight[piece_pos] & mask, moves);
+    }
+}
+
+template <BoardType BT, GenType GT = GEN_ALL>
+void generate_side_moves(const BoardData& d, U8 color, MoveList& moves) {
+
+    for (U64 bb = d.color_bb[color_idx(color)]; bb; pop_lsb(bb)) {
+        generate_piece_moves<BT, GT>(d, lsb(bb), moves);
+    }
+}
+
+// True if the move can be played by the side to move in this position,
+// ignoring whether it leaves the king in threat. Moves that come from
+// elsewhere, like hash moves and killers, are checked with this before use.
+template <BoardType BT>
+bool is_pseudolegal(const BoardData& d, U16 move) {
+
+    U8 p0 = getp0(move);
+    if (!(d.color_bb[color_idx(d.player_to_play)] & sqbit(p0))) return false;
+
+    MoveList moves;
+    generate_piece_moves<BT>(d, p0, moves);
+    return moves.contains(move);
+}
+
+// Walk the rays of a slider and report whether one of them reaches `tgt`
+// before running into an occupied square.
+inline bool slider_reaches(const SliderRays& rays, U8 tgt, U64 occ) {
+
+    int i = 0;
+    for (int r=0; r<rays.n_rays; r++) {
+        for (; i<rays.ray_end[r]; i++) {
+            U8 sq = rays.squares[i];
+            if (sq == tgt) return true;
+            if (occ & sqbit(sq)) break;
+        }
+        i = rays.ray_end[r];
+    }
+    return false;
+}
+
+// The squares a slider passes over before reaching `tgt` on an empty board.
+// Moving a piece off any of them can expose `tgt` to the slider.
+inline U64 slider_line(const SliderRays& rays, U8 tgt) {
+
+    U64 line = 0;
+    int i = 0;
+    for (int r=0; r<rays.n_rays; r++) {
+        U64 ray = 0;
+        for (; i<rays.ray_end[r]; i++) {
+            U8 sq = rays.squares[i];
+            if (sq == tgt) { line |= ray; break; }
+            ray |= sqbit(sq);
+        }
+        i = rays.ray_end[r];
+    }
+    return line;
+}
+
+// Attack test on bare bitboards, so that a position can be probed without
+// a BoardData to hold it.
+template <BoardType BT>
+bool square_attacked(const U64 *color_bb, const U64 *piece_bb, U8 sq, U8 by_color) {
+
+    typedef Layout<BT> L;
+    U64 them = color_bb[color_idx(by_color)];
+    U64 occ = color_bb[0] | color_bb[1];
+
+    if (them & piece_bb[piece_idx(PAWN)] & L::rays.pawn_from[sq]) return true;
+    if (them & piece_bb[piece_idx(KNIGHT)] & L::rays.knight[sq]) return true;
+    if (them & piece_bb[piece_idx(KING)] & L::rays.king[sq]) return true;
+
+    for (U64 bb = them & piece_bb[piece_idx(ROOK)] & L::rays.rook_from[sq]; bb; pop_lsb(bb)) {
+        if (slider_reaches(L::rays.rook[lsb(bb)], sq, occ)) return true;
+    }
+    for (U64 bb = them & piece_bb[piece_idx(BISHOP)] & L::rays.bishop_from[sq]; bb; pop_lsb(bb)) {
+        if (slider_reaches(L::rays.bishop[lsb(bb)], sq, occ)) return true;
+    }
+
+    return false;
+}
+
+template <BoardType BT>
+bool square_attacked(const BoardData& d, U8 sq, U8 by_color) {
+    return square_attacked<BT>(d.color_bb, d.piece_bb, sq, by_color);
+}
+
+// True if the king of the given color is attacked. A side without a king is
+// never in check.
+template <BoardType BT>
+bool king_attacked(const BoardData& d, U8 color) {
+
+    U8 king_pos = (color == WHITE) ? d.w_king : d.b_king;
+    if (king_pos == DEAD) return false;
+    return square_attacked<BT>(d, king_pos, color ^ (WHITE | BLACK));
+}
+
+// Every piece of either color that reaches `sq` with the given occupancy.
+// Pieces missing from occ are treated as gone, so sliders behind them, on
+// straight or reflected rays, come into play.
+template <BoardType BT>
+U64 attackers_to(const BoardData& d, U8 sq, U64 occ) {
+
+    typedef Layout<BT> L;
+    U64 attackers = (d.piece_bb[piece_idx(PAWN)] & L::rays.pawn_from[sq])
+                  | (d.piece_bb[piece_idx(KNIGHT)] & L::rays.knight[sq])
+                  | (d.piece_bb[piece_idx(KING)] & L::rays.king[sq]);
+
+    for (U64 bb = d.piece_bb[piece_idx(ROOK)] & L::rays.rook_from[sq] & occ; bb; pop_lsb(bb)) {
+        if (slider_reaches(L::rays.rook[lsb(bb)], sq, occ)) attackers |= sqbit(lsb(bb));
+    }
+    for (U64 bb = d.piece_bb[piece_idx(BISHOP)] & L::rays.bishop_from[sq] & occ; bb; pop_lsb(bb)) {
+        if (slider_reaches(L::rays.bishop[lsb(bb)], sq, occ)) attackers |= sqbit(lsb(bb));
+    }
+    return attackers & occ;
+}
+
+// Piece values for static exchange evaluation, indexed by piece_idx: the
+// material values, except that the king outweighs everything, so it only
+// ever captures last.
+constexpr int see_value(int idx) { return idx == piece_idx(KING) ? 20000 : piece_values[idx]; }
+constexpr int see_values[6] = {see_value(0), see_value(1), see_value(2), see_value(3), see_value(4), see_value(5)};
+
+// Cheapest first, the order in which attackers join an exchange.
+constexpr PieceType see_order[5] = {PAWN, KNIGHT, BISHOP, ROOK, KING};
+
+// Static exchange evaluation: the material the side making the move wins if
+// both sides keep recapturing on the target square with their least valuable
+// piece, and either side may stop when carrying on would lose material.
+template <BoardType BT>
+int static_exchange(const BoardData& d, U16 move) {
+
+    U8 from = getp0(move), to = getp1(move);
+    U8 victim = d.board_0[to];
+    U8 attacker = d.board_0[from];
+
+    int gain[32];
+    int n = 0;
+    gain[0] = victim ? see_values[piece_idx(victim)] : 0;
+    int on_square = see_values[piece_idx(attacker)];
+    if (getpromo(move)) {
+        on_square = see_values[piece_idx(getpromo(move) == PAWN_ROOK ? ROOK : BISHOP)];
+        gain[0] += on_square - see_values[piece_idx(PAWN)];
+    }
+
+    U64 occ = (d.color_bb[0] | d.color_bb[1]) ^ sqbit(from);
+    U64 attackers = attackers_to<BT>(d, to, occ);
+    int side = color_idx(color(attacker)) ^ 1;
+
+    while (n < 31) {
+        U64 ours = attackers & d.color_bb[side];
+        if (!ours) break;
+
+        PieceType type = KING;
+        U64 bb = 0;
+        for (auto t : see_order) {
+            bb = ours & d.piece_bb[piece_idx(t)];
+            if (bb) { type = t; break; }
+        }
+        U64 next_occ = occ ^ (bb & -bb);
+        U64 next_attackers = attackers_to<BT>(d, to, next_occ);
+
+        // the king can't take if the other side could take it back
+        if (type == KING && (next_attackers & d.color_bb[side ^ 1])) break;
+
+        n++;
+        gain[n] = on_square - gain[n-1];
+
+        occ = next_occ;
+        attackers = next_attackers;
+        on_square = see_values[piece_idx(type)];
+        side ^= 1;
+    }
+
+    // each side only takes if that does better than stopping
+    for (; n > 0; n--) gain[n-1] = -std::max(-gain[n-1], gain[n]);
+    return gain[0];
+}
+
+// Only king moves, moves while in check, and moves of pieces standing on a
+// line between an opponent slider and our king can leave the king in threat,
+// so every other pseudolegal move is accepted without playing it out.
+template <BoardType BT>
+void generate_legal_moves(const Board& b, MoveList& legal_moves) {
+
+    typedef Layout<BT> L;
+    const BoardData& d = b.data;
+
+    MoveList pseudolegal_moves;
+    generate_side_moves<BT>(d, d.player_to_play, pseudolegal_moves);
+
+    U8 color = d.player_to_play;
+    U8 oppcolor = color ^ (WHITE | BLACK);
+    U8 king_pos = (color == WHITE) ? d.w_king : d.b_king;
+
+    if (king_pos == DEAD) {
+        for (auto move : pseudolegal_moves) legal_moves.push(move);
+        return;
+    }
+
+    bool check = square_attacked<BT>(d, king_pos, oppcolor);
+
+    U64 them = d.color_bb[color_idx(oppcolor)];
+    U64 lines = 0;
+    for (U64 bb = them & d.piece_bb[piece_idx(ROOK)] & L::rays.rook_from[king_pos]; bb; pop_lsb(bb)) {
+        lines |= slider_line(L::rays.rook[lsb(bb)], king_pos);
+    }
+    for (U64 bb = them & d.piece_bb[piece_idx(BISHOP)] & L::rays.bishop_from[king_pos]; bb; pop_lsb(bb)) {
+        lines |= slider_line(L::rays.bishop[lsb(bb)], king_pos);
+    }
+
+    // a move is played out on copies of the bitboards only: the attack test
+    // reads nothing else, so the mailbox, hash and evaluation state (the
+    // network accumulator above all) are left alone. The type of our own
+    // moved piece does not matter to it, so promotions need no care.
+    for (auto move : pseudolegal_moves) {
+        U8 p0 = getp0(move);
+        U8 p1 = getp1(move);
+        if (!check && p0 != king_pos && !(lines & sqbit(p0))) {
+            legal_moves.push(move);
+            continue;
+        }
+
+        U64 color_bb[2] = {d.color_bb[0], d.color_bb[1]};
+        U64 piece_bb[6];
+        for (int i=0; i<6; i++) piece_bb[i] = d.piece_bb[i];
+
+        U8 deadpiece = d.board_0[p1];
+        if (deadpiece) {
+            color_bb[color_idx(oppcolor)] ^= sqbit(p1);
+            piece_bb[piece_idx(deadpiece)] ^= sqbit(p1);
+        }
+        color_bb[color_idx(color)] ^= sqbit(p0) | sqbit(p1);
+        piece_bb[piece_idx(d.board_0[p0])] ^= sqbit(p0) | sqbit(p1);
+
+        U8 sq = (p0 == king_pos) ? p1 : king_pos;
+        if (!square_attacked<BT>(color_bb, piece_bb, sq, oppcolor)) {
+            legal_moves.push(move);
+        }
+    }
+}
+
+// Calls fn(Layout<BT>()) for the layout of the given board type, turning a
+// runtime board type into a compile-time one: fn reads it back as
+// decltype(layout)::type.
+template <typename Fn>
+auto with_layout(BoardType btype, Fn&& fn) {
+
+    switch (btype) {
+        case SEVEN_THREE: return fn(Layout<SEVEN_THREE>());
+        case EIGHT_FOUR:  return fn(Layout<EIGHT_FOUR>());
+        default:          return fn(Layout<EIGHT_TWO>());
+    }
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <utility>
+#include "movegen.hpp"
+#include "search.hpp"
+
+/**
+ * Hands out the moves of a position one at a time, best guess first, and
+ * only generates each group of moves once the previous group has run out:
+ * the hash move, then captures and promotions by MVV-LVA, then the killer
+ * moves, then the remaining quiet moves by history score, and last the
+ * captures that static exchange evaluation says lose material. Alpha-beta
+ * mostly cuts off within the first few moves, so the later groups are often
+ * never generated.
+ *
+ * Moves are pseudolegal; the caller finds out whether they leave the king in
+ * threat by making them. The position must be the same on every call.
+ */
+template <BoardType BT>
+class MovePicker {
+
+    public:
+
+    /**
+     * Constructor - picks the moves of a node of the main search.
+     * @param d - the position.
+     * @param tt_move - the move from the transposition table, or 0.
+     * @param killers - the two killer moves of this ply.
+     * @param history - history scores of the side to move, by from and to square.
+     */
+    MovePicker(const BoardData &d, U16 tt_move, const U16 *killers, const int (*history)[64]):
+        d(d), tt_move(tt_move), history(history) {
+
+        this->killers[0] = killers[0];
+        this->killers[1] = killers[1];
+        this->stage = STAGE_TT;
+    }
+
+    /**
+     * Constructor - picks the captures and promotions of a quiescence node.
+     * Those that lose material by static exchange evaluation are skipped.
+     * @param d - the position.
+     */
+    MovePicker(const BoardData &d): d(d), tt_move(0), history(nullptr) {
+
+        this->killers[0] = this->killers[1] = 0;
+        this->stage = STAGE_GEN_NOISY;
+        this->noisy_only = true;
+    }
+
+    /**
+     * @return the next move to try, or 0 once all moves have been handed out.
+     */
+    U16 next() {
+
+        switch (this->stage) {
+
+        case STAGE_TT:
+            this->stage = STAGE_GEN_NOISY;
+            if (this->tt_move && is_pseudolegal<BT>(this->d, this->tt_move)) return this->tt_move;
+            // fall through
+
+        case STAGE_GEN_NOISY:
+            this->moves.clear();
+            generate_side_moves<BT, GEN_NOISY>(this->d, this->d.player_to_play, this->moves);
+            this->score_noisy();
+            this->cur = 0;
+            this->stage = STAGE_NOISY;
+            // fall through
+
+        case STAGE_NOISY:
+            while (this->cur < this->moves.size()) {
+                U16 m = this->pick_best();
+                if (m == this->tt_move) continue;
+                if (this->wins_material(m)) return m;
+                if (!this->noisy_only) this->bad_noisy.push(m);
+            }
+            if (this->noisy_only) {
+                this->stage = STAGE_DONE;
+                return 0;
+            }
+            this->stage = STAGE_KILLER_1;
+            // fall through
+
+        case STAGE_KILLER_1:
+            this->stage = STAGE_KILLER_2;
+            if (this->is_quiet_killer(this->killers[0])) return this->killers[0];
+            // fall through
+
+        case STAGE_KILLER_2:
+            this->stage = STAGE_GEN_QUIET;
+            if (this->killers[1] != this->killers[0] && this->is_quiet_killer(this->killers[1])) {
+                return this->killers[1];
+            }
+            // fall through
+
+        case STAGE_GEN_QUIET:
+            this->moves.clear();
+            generate_side_moves<BT, GEN_QUIET>(this->d, this->d.player_to_play, this->moves);
+            this->score_quiet();
+            this->cur = 0;
+            this->stage = STAGE_QUIET;
+            // fall through
+
+        case STAGE_QUIET:
+            while (this->cur < this->moves.size()) {
+                U16 m = this->pick_best();
+                if (m != this->tt_move && m != this->killers[0] && m != this->killers[1]) return m;
+            }
+            this->cur = 0;
+            this->stage = STAGE_BAD_NOISY;
+            // fall through
+
+        case STAGE_BAD_NOISY:
+            // already in MVV-LVA order
+            if (this->cur < this->bad_noisy.size()) return this->bad_noisy[this->cur++];
+            this->stage = STAGE_DONE;
+            // fall through
+
+        default:
+            return 0;
+        }
+    }
+
+    private:
+
+    enum Stage {
+        STAGE_TT,
+        STAGE_GEN_NOISY,
+        STAGE_NOISY,
+        STAGE_KILLER_1,
+        STAGE_KILLER_2,
+        STAGE_GEN_QUIET,
+        STAGE_QUIET,
+        STAGE_BAD_NOISY,
+        STAGE_DONE
+    };
+
+    const BoardData &d;
+    U16 tt_move;
+    U16 killers[2];
+    const int (*history)[64];
+    bool noisy_only = false;
+
+    int stage;
+    MoveList moves;
+    MoveList bad_noisy;
+    int scores[MoveList::capacity];
+    int cur = 0;
+
+    // most valuable victim first, least valuable attacker among equals
+    void score_noisy() {
+
+        for (int i=0; i<this->moves.size(); i++) {
+            U16 m = this->moves[i];
+            U8 victim = this->d.board_0[getp1(m)];
+            U8 attacker = this->d.board_0[getp0(m)];
+
+            int gain = victim ? piece_values[piece_idx(victim)] : 0;
+            if (getpromo(m)) gain += piece_values[piece_idx(getpromo(m) == PAWN_ROOK ? ROOK : BISHOP)];
+            this->scores[i] = gain * 16 - piece_values[piece_idx(attacker)] / 16;
+        }
+    }
+
+    void score_quiet() {
+
+        for (int i=0; i<this->moves.size(); i++) {
+            U16 m = this->moves[i];
+            this->scores[i] = this->history[getp0(m)][getp1(m)];
+        }
+    }
+
+    // Selection sort step: moves the best scored of the remaining moves to
+    // the front and returns it.
+    U16 pick_best() {
+
+        int best = this->cur;
+        for (int j=this->cur+1; j<this->moves.size(); j++) {
+            if (this->scores[j] > this->scores[best]) best = j;
+        }
+        std::swap(this->moves[this->cur], this->moves[best]);
+        std::swap(this->scores[this->cur], this->scores[best]);
+        return this->moves[this->cur++];
+    }
+
+    // Taking a piece worth at least as much as the capturer can't lose
+    // material, so the exchange only needs to be played out for the rest.
+    bool wins_material(U16 m) const {
+
+        U8 victim = this->d.board_0[getp1(m)];
+        U8 attacker = this->d.board_0[getp0(m)];
+        if (!getpromo(m) && see_values[piece_idx(victim)] >= see_values[piece_idx(attacker)]) return true;
+        return static_exchange<BT>(this->d, m) >= 0;
+    }
+
+    // Killers come from sibling nodes, so they are only tried if they are
+    // still quiet and playable here.
+    bool is_quiet_killer(U16 m) const {
+
+        return m && m != this->tt_move && !getpromo(m)
+            && !this->d.board_0[getp1(m)] && is_pseudolegal<BT>(this->d, m);
+    }
+};
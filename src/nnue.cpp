@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#if defined(__AVX2__) || defined(__SSSE3__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "board.hpp"
+#include "nnue.hpp"
+#include "search.hpp"
+
+NNUENetwork nnue_net;
+bool nnue_enabled = false;
+
+// Index of the feature of a piece as seen from one side. Black sees the
+// board rotated by 180 degrees and its own pieces first, which makes its view
+// of any position the same as white's of the mirrored one.
+static inline int nnue_feature(int board_type, U8 piece, U8 sq, int persp) {
+
+    int c = color_idx(piece & (WHITE | BLACK));
+    if (persp == color_idx(BLACK)) {
+        c ^= 1;
+        sq = (board_type == SEVEN_THREE ? cw_180_7x7 : cw_180_8x8)[sq];
+    }
+    return (((board_type - 1) * 10 + c * 5 + piece_idx(piece) - 1) << 6) | sq;
+}
+
+static inline void add_weights(int16_t *acc, const int16_t *w) {
+#if defined(__AVX2__)
+    for (int i=0; i<NNUE_HIDDEN; i+=16) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(acc + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(w + i));
+        _mm256_storeu_si256((__m256i*)(acc + i), _mm256_add_epi16(a, b));
+    }
+#elif defined(__SSE2__)
+    for (int i=0; i<NNUE_HIDDEN; i+=8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(acc + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(w + i));
+        _mm_storeu_si128((__m128i*)(acc + i), _mm_add_epi16(a, b));
+    }
+#else
+    for (int i=0; i<NNUE_HIDDEN; i++) acc[i] += w[i];
+#endif
+}
+
+static inline void sub_weights(int16_t *acc, const int16_t *w) {
+#if defined(__AVX2__)
+    for (int i=0; i<NNUE_HIDDEN; i+=16) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(acc + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(w + i));
+        _mm256_storeu_si256((__m256i*)(acc + i), _mm256_sub_epi16(a, b));
+    }
+#elif defined(__SSE2__)
+    for (int i=0; i<NNUE_HIDDEN; i+=8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(acc + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(w + i));
+        _mm_storeu_si128((__m128i*)(acc + i), _mm_sub_epi16(a, b));
+    }
+#else
+    for (int i=0; i<NNUE_HIDDEN; i++) acc[i] -= w[i];
+#endif
+}
+
+// Dot product of n unsigned 8-bit activations (at most 127) with signed
+// 8-bit weights; n is a multiple of 32.
+static inline int32_t dot_u8_i8(const uint8_t *in, const int8_t *w, int n) {
+#if defined(__AVX2__)
+    __m256i sum = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (int i=0; i<n; i+=32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(in + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(w + i));
+        // pairs of products stay below 2 * 127 * 128 and cannot saturate
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(a, b), ones));
+    }
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+    return _mm_cvtsi128_si32(s);
+#elif defined(__SSSE3__)
+    __m128i sum = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    for (int i=0; i<n; i+=16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(w + i));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(a, b), ones));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+    return _mm_cvtsi128_si32(sum);
+#elif defined(__SSE2__)
+    // no unsigned by signed byte multiply: widen both to 16 bits first
+    __m128i sum = _mm_setzero_si128();
+    const __m128i zero = _mm_setzero_si128();
+    for (int i=0; i<n; i+=16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(w + i));
+        __m128i b_lo = _mm_srai_epi16(_mm_unpacklo_epi8(b, b), 8);
+        __m128i b_hi = _mm_srai_epi16(_mm_unpackhi_epi8(b, b), 8);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi8(a, zero), b_lo));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpackhi_epi8(a, zero), b_hi));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+    return _mm_cvtsi128_si32(sum);
+#else
+    int32_t sum = 0;
+    for (int i=0; i<n; i++) sum += (int32_t)in[i] * w[i];
+    return sum;
+#endif
+}
+
+static inline uint8_t clipped_relu(int32_t x) {
+    return (uint8_t)std::min(std::max(x, 0), 127);
+}
+
+static void dense_layer(const uint8_t *in, int n_in, const int8_t *weights, const int32_t *biases,
+                        uint8_t *out, int n_out) {
+
+    for (int j=0; j<n_out; j++) {
+        int32_t sum = biases[j] + dot_u8_i8(in, weights + j * n_in, n_in);
+        out[j] = clipped_relu(sum >> NNUE_WEIGHT_SHIFT);
+    }
+}
+
+void nnue_refresh(NNUEAccumulator &acc, const U8 *board, int board_type) {
+
+    for (int persp=0; persp<2; persp++) {
+        memcpy(acc.values[persp], nnue_net.ft_biases, sizeof(acc.values[persp]));
+        for (int sq=0; sq<64; sq++) {
+            U8 piece = board[sq];
+            if (!(piece & (WHITE | BLACK))) continue;
+            add_weights(acc.values[persp], nnue_net.ft_weights[nnue_feature(board_type, piece, sq, persp)]);
+        }
+    }
+}
+
+void nnue_add(NNUEAccumulator &acc, int board_type, U8 piece, U8 sq) {
+    add_weights(acc.values[0], nnue_net.ft_weights[nnue_feature(board_type, piece, sq, 0)]);
+    add_weights(acc.values[1], nnue_net.ft_weights[nnue_feature(board_type, piece, sq, 1)]);
+}
+
+void nnue_remove(NNUEAccumulator &acc, int board_type, U8 piece, U8 sq) {
+    sub_weights(acc.values[0], nnue_net.ft_weights[nnue_feature(board_type, piece, sq, 0)]);
+    sub_weights(acc.values[1], nnue_net.ft_weights[nnue_feature(board_type, piece, sq, 1)]);
+}
+
+int nnue_evaluate(const NNUEAccumulator &acc, int stm) {
+
+    // the side to move's half comes first
+    alignas(32) uint8_t hidden[2 * NNUE_HIDDEN];
+    for (int i=0; i<NNUE_HIDDEN; i++) {
+        hidden[i] = clipped_relu(acc.values[stm][i]);
+        hidden[NNUE_HIDDEN + i] = clipped_relu(acc.values[stm ^ 1][i]);
+    }
+
+    alignas(32) uint8_t l2[NNUE_L2];
+    alignas(32) uint8_t l3[NNUE_L3];
+    dense_layer(hidden, 2 * NNUE_HIDDEN, &nnue_net.l2_weights[0][0], nnue_net.l2_biases, l2, NNUE_L2);
+    dense_layer(l2, NNUE_L2, &nnue_net.l3_weights[0][0], nnue_net.l3_biases, l3, NNUE_L3);
+
+    // whatever the network says, stay below the mate scores
+    const int max_score = MATE_SCORE - MAX_PLY - 1;
+    int32_t out = nnue_net.out_bias + dot_u8_i8(l3, nnue_net.out_weights, NNUE_L3);
+    return std::min(std::max(out / NNUE_OUTPUT_SCALE, -max_score), max_score);
+}
+
+bool load_nnue_file(const std::string &path) {
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cout << "ERROR: could not open " << path << std::endl;
+        return false;
+    }
+
+    char magic[4];
+    uint32_t header[5];
+    const uint32_t expected[5] = {1, NNUE_INPUTS, NNUE_HIDDEN, NNUE_L2, NNUE_L3};
+    in.read(magic, sizeof(magic));
+    in.read((char*)header, sizeof(header));
+    if (!in || memcmp(magic, "RBNN", 4) != 0 || memcmp(header, expected, sizeof(header)) != 0) {
+        std::cout << "ERROR: " << path << " is not a version 1 eval file for "
+                  << NNUE_INPUTS << "x" << NNUE_HIDDEN << "x" << NNUE_L2 << "x" << NNUE_L3 << std::endl;
+        return false;
+    }
+
+    in.read((char*)nnue_net.ft_biases, sizeof(nnue_net.ft_biases));
+    in.read((char*)nnue_net.ft_weights, sizeof(nnue_net.ft_weights));
+    in.read((char*)nnue_net.l2_biases, sizeof(nnue_net.l2_biases));
+    in.read((char*)nnue_net.l2_weights, sizeof(nnue_net.l2_weights));
+    in.read((char*)nnue_net.l3_biases, sizeof(nnue_net.l3_biases));
+    in.read((char*)nnue_net.l3_weights, sizeof(nnue_net.l3_weights));
+    in.read((char*)&nnue_net.out_bias, sizeof(nnue_net.out_bias));
+    in.read((char*)nnue_net.out_weights, sizeof(nnue_net.out_weights));
+    if (!in || in.peek() != EOF) {
+        std::cout << "ERROR: " << path << " has the wrong size" << std::endl;
+        return false;
+    }
+
+    nnue_enabled = true;
+    return true;
+}
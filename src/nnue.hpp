@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "constants.hpp"
+
+// Network dimensions. The inputs are one feature per (board type, colored
+// piece, square): 3 layouts of 10 pieces on 64 squares.
+#define NNUE_INPUTS (3 * 10 * 64)
+#define NNUE_HIDDEN 128
+#define NNUE_L2 32
+#define NNUE_L3 32
+
+// Dense layer outputs are scaled down by 2^NNUE_WEIGHT_SHIFT before the
+// clipped ReLU, and the final output by NNUE_OUTPUT_SCALE to centipawns.
+#define NNUE_WEIGHT_SHIFT 6
+#define NNUE_OUTPUT_SCALE 16
+
+/**
+ * First layer outputs for both perspectives, indexed by color_idx. Each
+ * perspective sees its own pieces as the first five piece types and the
+ * board rotated so that it plays from the bottom, so one set of weights
+ * serves both sides.
+ */
+struct alignas(32) NNUEAccumulator {
+    int16_t values[2][NNUE_HIDDEN];
+};
+
+/**
+ * Quantized weights: int16 for the sparse first layer, int8 with int32
+ * biases for the dense layers.
+ *
+ * The eval file is little-endian: the magic "RBNN", a uint32 version (1),
+ * the four uint32 dimensions above, then ft_biases, ft_weights, l2_biases,
+ * l2_weights, l3_biases, l3_weights, out_bias and out_weights in that order
+ * and with the shapes declared here.
+ */
+struct NNUENetwork {
+    alignas(32) int16_t ft_biases[NNUE_HIDDEN];
+    alignas(32) int16_t ft_weights[NNUE_INPUTS][NNUE_HIDDEN];
+    int32_t l2_biases[NNUE_L2];
+    alignas(32) int8_t l2_weights[NNUE_L2][2 * NNUE_HIDDEN];
+    int32_t l3_biases[NNUE_L3];
+    alignas(32) int8_t l3_weights[NNUE_L3][NNUE_L2];
+    int32_t out_bias;
+    alignas(32) int8_t out_weights[NNUE_L3];
+};
+
+extern NNUENetwork nnue_net;
+
+// Set once a network has been loaded. Until then make/unmake leave the
+// accumulator alone and the search evaluates with the piece-square tables.
+extern bool nnue_enabled;
+
+/**
+ * @brief Loads the network weights from a file. Has to be called before any
+ * board is set up.
+ * @param path - the eval file.
+ * @return true if the network was loaded and enabled.
+ */
+bool load_nnue_file(const std::string &path);
+
+/**
+ * @brief Computes the accumulator of a position from scratch.
+ * @param acc - the accumulator to fill.
+ * @param board - board_0 of the position.
+ * @param board_type - the layout.
+ */
+void nnue_refresh(NNUEAccumulator &acc, const U8 *board, int board_type);
+
+/**
+ * @brief Adds or removes one piece in the accumulator.
+ * @param acc - the accumulator to update.
+ * @param board_type - the layout.
+ * @param piece - the colored piece.
+ * @param sq - its board_0 square.
+ */
+void nnue_add(NNUEAccumulator &acc, int board_type, U8 piece, U8 sq);
+void nnue_remove(NNUEAccumulator &acc, int board_type, U8 piece, U8 sq);
+
+/**
+ * @brief Runs the dense layers on top of an accumulator.
+ * @param acc - the accumulator of the position.
+ * @param stm - color_idx of the side to move.
+ * @return the score in centipawns from the side to move's view, kept below
+ * the mate scores of the search.
+ */
+int nnue_evaluate(const NNUEAccumulator &acc, int stm);
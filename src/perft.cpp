@@ -0,0 +1,172 @@
+#include <popl.hpp>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "board.hpp"
+#include "butils.hpp"
+
+// Counts the leaf nodes of the legal move tree, down to the given depth.
+// Leaves are counted in bulk at depth 1.
+uint64_t perft(Board& b, int depth) {
+
+    MoveList moves;
+    b.generate_legal(moves);
+    if (depth <= 1) return moves.size();
+
+    uint64_t nodes = 0;
+    for (auto m : moves) {
+        b.do_move_(m);
+        nodes += perft(b, depth-1);
+        b.undo_move_();
+    }
+    return nodes;
+}
+
+// Plays the given moves from the start position, rejecting illegal ones.
+bool setup_board(Board& b, const std::vector<std::string>& moves) {
+    for (auto& ms : moves) {
+        U16 m = str_to_move(ms);
+        MoveList legal;
+        b.generate_legal(legal);
+        if (!legal.contains(m)) {
+            std::cout << "Illegal move " << ms << " in position\n" << board_to_str(&b.data);
+            return false;
+        }
+        b.do_move_(m);
+    }
+    return true;
+}
+
+uint64_t run_perft(Board& b, int depth, bool divide) {
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t nodes = 0;
+
+    if (divide) {
+        MoveList moves;
+        b.generate_legal(moves);
+        for (auto m : moves) {
+            b.do_move_(m);
+            uint64_t n = depth > 1 ? perft(b, depth-1) : 1;
+            b.undo_move_();
+            std::cout << "  " << move_to_str(m) << ": " << n << "\n";
+            nodes += n;
+        }
+    }
+    else {
+        nodes = perft(b, depth);
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(end - start).count();
+    std::cout << "depth " << depth << " nodes " << nodes
+              << " time " << (int)(secs * 1000) << " ms"
+              << " nps " << (uint64_t)(secs > 0 ? nodes / secs : 0) << std::endl;
+    return nodes;
+}
+
+// Each non-comment line of the counts file reads
+//     <board> <depth> <nodes> [moves...]
+// where the moves (if any) are played from the start position first.
+int run_compare(const std::string& path) {
+
+    std::ifstream in(path);
+    if (!in) {
+        std::cout << "ERROR: could not open " << path << std::endl;
+        return 1;
+    }
+
+    int n_failed = 0, n_run = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        std::istringstream iss(line);
+        std::string type_str, ms;
+        int depth;
+        uint64_t expected;
+        std::vector<std::string> moves;
+        iss >> type_str >> depth >> expected;
+        while (iss >> ms) moves.push_back(ms);
+
+        BoardType btype;
+        if (!parse_board_type(type_str, btype)) {
+            std::cout << "ERROR: unknown board type " << type_str << std::endl;
+            return 1;
+        }
+
+        Board b(btype);
+        if (!setup_board(b, moves)) return 1;
+
+        std::cout << type_str << " (" << moves.size() << " moves played) ";
+        uint64_t nodes = run_perft(b, depth, false);
+        n_run++;
+        if (nodes != expected) {
+            std::cout << "  FAILED: expected " << expected << " got " << nodes << std::endl;
+            n_failed++;
+        }
+    }
+
+    std::cout << n_run - n_failed << "/" << n_run << " perft counts match" << std::endl;
+    return n_failed ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+
+    popl::OptionParser op("Rollerball perft");
+    std::string type_str, moves_str, compare_path;
+    int depth;
+    auto help_op    = op.add<popl::Switch>("h", "help", "produce help message");
+    op.add<popl::Value<std::string>>("t", "type", "board type (board-7-3, board-8-4, board-8-2 or all)", "all", &type_str);
+    op.add<popl::Value<int>>("d", "depth", "search depth", 4, &depth);
+    op.add<popl::Value<std::string>>("m", "moves", "moves to play from the start position", "", &moves_str);
+    auto divide_op  = op.add<popl::Switch>("", "divide", "print node counts per root move");
+    auto compare_op = op.add<popl::Value<std::string>>("c", "compare", "file of known perft counts to check against", "", &compare_path);
+    op.parse(argc, argv);
+
+    if (help_op->is_set()) {
+        std::cout << op << std::endl;
+        return 0;
+    }
+
+    if (compare_op->is_set()) {
+        return run_compare(compare_path);
+    }
+
+    std::vector<BoardType> btypes;
+    if (type_str == "all") {
+        btypes = {SEVEN_THREE, EIGHT_FOUR, EIGHT_TWO};
+    }
+    else {
+        BoardType btype;
+        if (!parse_board_type(type_str, btype)) {
+            std::cout << "ERROR: unknown board type " << type_str << std::endl;
+            return 1;
+        }
+        btypes = {btype};
+    }
+
+    std::vector<std::string> moves;
+    std::istringstream iss(moves_str);
+    std::string ms;
+    while (iss >> ms) moves.push_back(ms);
+
+    if (!moves.empty() && btypes.size() > 1) {
+        std::cout << "ERROR: a board type is needed to play moves" << std::endl;
+        return 1;
+    }
+
+    for (auto btype : btypes) {
+        Board b(btype);
+        if (!setup_board(b, moves)) return 1;
+
+        std::cout << board_type_to_str(btype) << "\n" << board_to_str(&b.data);
+        run_perft(b, depth, divide_op->is_set());
+    }
+
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "board.hpp"
+#include "movegen.hpp"
+#include "pst.hpp"
+
+PieceSquareTables pst_tables[4];
+
+static const char *piece_names[6] = {"", "pawn", "rook", "king", "bishop", "knight"};
+static const char *board_names[4] = {"", "board-7-3", "board-8-4", "board-8-2"};
+
+// the tables are in place before main() runs
+static const bool pst_defaults_set = (set_default_pst(), true);
+
+template <BoardType BT>
+static const U8 *rotate_180() {
+    return BT == SEVEN_THREE ? cw_180_7x7 : cw_180_8x8;
+}
+
+// Fills in black's table from white's.
+static void mirror_pst(BoardType btype, const U8 *cw_180) {
+
+    PieceSquareTables &t = pst_tables[btype];
+    for (int p=0; p<6; p++) {
+        for (int sq=0; sq<64; sq++) t.value[color_idx(BLACK)][p][sq] = 0;
+        for (int sq=0; sq<64; sq++) {
+            t.value[color_idx(BLACK)][p][cw_180[sq]] = -t.value[color_idx(WHITE)][p][sq];
+        }
+    }
+}
+
+// Pieces are worth more on squares where they reach further, and pawns the
+// closer they get to promoting (counted in pawn moves on an empty board).
+template <BoardType BT>
+static void set_layout_default_pst() {
+
+    const RayTable &rays = Layout<BT>::rays;
+    int (*white)[64] = pst_tables[BT].value[color_idx(WHITE)];
+
+    int pawn_dist[64];
+    for (int sq=0; sq<64; sq++) pawn_dist[sq] = -1;
+    U64 frontier = Layout<BT>::pawn_promo_bb[color_idx(WHITE)];
+    U64 seen = frontier;
+    for (int dist=0; frontier; dist++) {
+        U64 next = 0;
+        for (U64 bb = frontier; bb; bb &= bb - 1) {
+            U8 sq = lsb(bb);
+            pawn_dist[sq] = dist;
+            next |= rays.pawn_from[sq];
+        }
+        frontier = next & ~seen;
+        seen |= next;
+    }
+
+    for (int p=0; p<6; p++) {
+        for (int sq=0; sq<64; sq++) white[p][sq] = 0;
+    }
+    for (U64 bb = Layout<BT>::board_bb; bb; bb &= bb - 1) {
+        U8 sq = lsb(bb);
+        white[piece_idx(PAWN)][sq]   = piece_values[piece_idx(PAWN)]   + (pawn_dist[sq] > 0 ? 60 / pawn_dist[sq] : 0);
+        white[piece_idx(ROOK)][sq]   = piece_values[piece_idx(ROOK)]   + 3 * popcount(rays.rook[sq].reach);
+        white[piece_idx(BISHOP)][sq] = piece_values[piece_idx(BISHOP)] + 3 * popcount(rays.bishop[sq].reach);
+        white[piece_idx(KNIGHT)][sq] = piece_values[piece_idx(KNIGHT)] + 4 * popcount(rays.knight[sq]);
+        white[piece_idx(KING)][sq]   = piece_values[piece_idx(KING)]   + 2 * popcount(rays.king[sq]);
+    }
+
+    mirror_pst(BT, rotate_180<BT>());
+}
+
+void set_default_pst() {
+    set_layout_default_pst<SEVEN_THREE>();
+    set_layout_default_pst<EIGHT_FOUR>();
+    set_layout_default_pst<EIGHT_TWO>();
+}
+
+template <typename T>
+static int find_name(const T &names, const std::string &name) {
+    for (int i=1; i<(int)(sizeof(names) / sizeof(names[0])); i++) {
+        if (name == names[i]) return i;
+    }
+    return -1;
+}
+
+bool load_pst_file(const std::string &path) {
+
+    std::ifstream in(path);
+    if (!in) {
+        std::cout << "ERROR: could not open " << path << std::endl;
+        return false;
+    }
+
+    std::string token;
+    while (in >> token) {
+        if (token[0] == '#') {
+            std::getline(in, token);
+            continue;
+        }
+
+        int btype = find_name(board_names, token);
+        std::string piece;
+        in >> piece;
+        int p = find_name(piece_names, piece);
+        if (btype < 0 || p < 0) {
+            std::cout << "ERROR: " << path << ": expected a layout and a piece, got "
+                      << token << " " << piece << std::endl;
+            return false;
+        }
+
+        // laid out like the board, top row first
+        int values[64];
+        for (int i=0; i<64; i++) {
+            if (!(in >> values[pos(i % 8, 7 - i / 8)])) {
+                std::cout << "ERROR: " << path << ": " << token << " " << piece
+                          << " needs 64 values" << std::endl;
+                return false;
+            }
+        }
+
+        with_layout((BoardType)btype, [&](auto layout) {
+            constexpr BoardType BT = decltype(layout)::type;
+            for (int sq=0; sq<64; sq++) {
+                if (Layout<BT>::board_bb & sqbit(sq)) pst_tables[BT].value[color_idx(WHITE)][p][sq] = values[sq];
+            }
+            mirror_pst(BT, rotate_180<BT>());
+        });
+    }
+
+    return true;
+}
+
+bool write_pst_file(const std::string &path) {
+
+    std::ofstream out(path);
+    if (!out) return false;
+
+    out << "# <layout> <piece> followed by 8 rows of 8 values laid out like the board,\n"
+        << "# from white's point of view; black uses them rotated by 180 degrees.\n";
+    for (int btype=SEVEN_THREE; btype<=EIGHT_TWO; btype++) {
+        for (int p=1; p<6; p++) {
+            out << board_names[btype] << " " << piece_names[p] << "\n";
+            for (int y=7; y>=0; y--) {
+                for (int x=0; x<8; x++) out << " " << pst_tables[btype].value[color_idx(WHITE)][p][pos(x, y)];
+                out << "\n";
+            }
+        }
+    }
+
+    return (bool)out;
+}
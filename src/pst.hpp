@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include "constants.hpp"
+
+/**
+ * Material plus piece-square values of one board layout, in centipawns.
+ * value is indexed with color_idx, piece_idx and the board_0 square. White's
+ * entries are positive and black's negative, so the score of a position is
+ * the plain sum over its pieces; black's table is white's rotated by 180
+ * degrees, the symmetry between the two sides of every layout.
+ */
+struct PieceSquareTables {
+    int value[2][6][64];
+};
+
+// Tables in use, indexed by board type. They start out as the built-in
+// defaults and can be replaced from a file before the first game starts.
+extern PieceSquareTables pst_tables[4];
+
+#define pst_value(bt, p, sq) (pst_tables[(bt)].value[color_idx((p) & (WHITE | BLACK))][piece_idx(p)][(sq)])
+
+/**
+ * @brief Resets the tables of every layout to the built-in defaults.
+ */
+void set_default_pst();
+
+/**
+ * @brief Replaces the tables with the ones in a file. The file holds, for
+ * any number of (layout, piece) pairs, the layout name (board-7-3, board-8-4
+ * or board-8-2), the piece name (pawn, rook, king, bishop or knight) and 64
+ * values from white's point of view, laid out like the board with the top
+ * row first. Squares off the ring are ignored, and pairs that are not listed keep their values.
+ * Lines starting with # are comments.
+ * @param path - the file to read.
+ * @return true if the whole file was read, false (leaving the tables
+ * partially updated) on a parse error.
+ */
+bool load_pst_file(const std::string &path);
+
+/**
+ * @brief Writes the tables in use in the format read by load_pst_file, as a
+ * starting point for tuning.
+ * @param path - the file to write.
+ * @return true on success.
+ */
+bool write_pst_file(const std::string &path);
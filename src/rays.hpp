@@ -0,0 +1,190 @@
+#pragma once
+
+#include "constants.hpp"
+
+/**
+ * The squares a rook or bishop on one square can slide over on an empty
+ * board, as a handful of ordered rays in board_0 coordinates. Rays already
+ * include the ring-dependent rules (the rook's one step at the right end, the
+ * rook's reflection along the outer ring and the bishop's edge reflections),
+ * so a slider's moves are found by walking each ray up to the first blocker.
+ * Ray i covers squares[ray_end[i-1]] up to (but excluding) squares[ray_end[i]].
+ */
+struct SliderRays {
+    U8 n_rays = 0;
+    U8 ray_end[4] = {0, 0, 0, 0};
+    U8 squares[32] = {0};
+    U64 reach = 0; // every square on any of the rays
+};
+
+/**
+ * The rook and bishop rays of every square of a board layout, together with
+ * the squares kings, knights and pawns step to. The *_from masks are the
+ * reverse lookups: the squares from which a piece of that type reaches a
+ * given square on an empty board. Squares off the board have no entries.
+ */
+struct RayTable {
+    SliderRays rook[64];
+    SliderRays bishop[64];
+
+    U64 king[64] = {0};
+    U64 knight[64] = {0};
+    U64 pawn[64] = {0};
+
+    U64 rook_from[64] = {0};
+    U64 bishop_from[64] = {0};
+    U64 pawn_from[64] = {0};
+};
+
+// Helpers that build the tables at compile time. They follow the canonical
+// (bottom quadrant) movement rules the original generators used on the rotated
+// boards, and transform the resulting squares back into board_0 coordinates.
+
+constexpr bool ray_inboard(const U8 *mask, int x, int y) {
+    return inboard(mask, x, y);
+}
+
+constexpr void ray_push(SliderRays &r, const U8 *transform, int x, int y) {
+    U8 sq = transform[pos(x, y)];
+    r.squares[r.ray_end[r.n_rays]++] = sq;
+    r.reach |= sqbit(sq);
+}
+
+constexpr void ray_close(SliderRays &r) {
+    if (r.ray_end[r.n_rays] == (r.n_rays ? r.ray_end[r.n_rays-1] : 0)) return;
+    r.n_rays++;
+    if (r.n_rays < 4) r.ray_end[r.n_rays] = r.ray_end[r.n_rays-1];
+}
+
+constexpr SliderRays make_rook_rays(const U8 *mask, const U8 *transform, U8 p0) {
+
+    SliderRays r;
+    int x = getx(p0), y = gety(p0);
+
+    // right - move one square
+    if (ray_inboard(mask, x+1, y)) ray_push(r, transform, x+1, y);
+    ray_close(r);
+
+    // bottom - move one square
+    if (ray_inboard(mask, x, y-1)) ray_push(r, transform, x, y-1);
+    ray_close(r);
+
+    // top - move multiple if left end (forward), move one if right end
+    if (ray_inboard(mask, x, y+1)) {
+        if (x >= 4) ray_push(r, transform, x, y+1);
+        else {
+            for (int s=1; ray_inboard(mask, x, y+s); s++) ray_push(r, transform, x, y+s);
+        }
+    }
+    ray_close(r);
+
+    // left, then reflect up along the left edge if on the outer ring
+    for (int s=1; ray_inboard(mask, x-s, y); s++) ray_push(r, transform, x-s, y);
+    if (y == 0) {
+        for (int s=1; ray_inboard(mask, 0, s); s++) ray_push(r, transform, 0, s);
+    }
+    ray_close(r);
+
+    return r;
+}
+
+constexpr SliderRays make_bishop_rays(const U8 *mask, const U8 *transform, U8 p0) {
+
+    SliderRays r;
+    int x = getx(p0), y = gety(p0);
+
+    // top right - move one square
+    if (ray_inboard(mask, x+1, y+1)) ray_push(r, transform, x+1, y+1);
+    ray_close(r);
+
+    // bottom right - move one square
+    if (ray_inboard(mask, x+1, y-1)) ray_push(r, transform, x+1, y-1);
+    ray_close(r);
+
+    // top left - move till reflection, then reflect on the left / top edge
+    int s = 1;
+    for (; ray_inboard(mask, x-s, y+s); s++) ray_push(r, transform, x-s, y+s);
+    if (s > 1) {
+        int x1 = x-s+1, y1 = y+s-1;
+        if (x1 == 0) {
+            for (int t=1; ray_inboard(mask, x1+t, y1+t); t++) ray_push(r, transform, x1+t, y1+t);
+        }
+        else {
+            for (int t=1; ray_inboard(mask, x1-t, y1-t); t++) ray_push(r, transform, x1-t, y1-t);
+        }
+    }
+    ray_close(r);
+
+    // bottom left - move till reflection, then reflect on the bottom edge
+    s = 1;
+    for (; ray_inboard(mask, x-s, y-s); s++) ray_push(r, transform, x-s, y-s);
+    if (s > 1) {
+        int x1 = x-s+1, y1 = y-s+1;
+        for (int t=1; ray_inboard(mask, x1-t, y1+t); t++) ray_push(r, transform, x1-t, y1+t);
+    }
+    ray_close(r);
+
+    return r;
+}
+
+// Kings and knights move the same way in every quadrant, so their squares can
+// be found on board_0 directly.
+constexpr U64 make_step_mask(const U8 *mask, U8 p0, const int *x_incrs, const int *y_incrs) {
+
+    U64 bb = 0;
+    for (int i=0; i<8; i++) {
+        int x = getx(p0)+x_incrs[i], y = gety(p0)+y_incrs[i];
+        if (ray_inboard(mask, x, y)) bb |= sqbit(pos(x, y));
+    }
+    return bb;
+}
+
+constexpr U64 make_pawn_mask(const U8 *mask, const U8 *transform, U8 p0) {
+
+    U64 bb = 0;
+    int x = getx(p0)-1;
+    for (int y = gety(p0)-1; y <= gety(p0)+1; y++) {
+        if (ray_inboard(mask, x, y)) bb |= sqbit(transform[pos(x, y)]);
+    }
+    return bb;
+}
+
+constexpr int king_x_incrs[8]   = {1, 1,  1, 0,  0, -1, -1, -1};
+constexpr int king_y_incrs[8]   = {1, 0, -1, 1, -1,  1,  0, -1};
+constexpr int knight_x_incrs[8] = {1, 2,  2,  1, -1, -2, -2, -1};
+constexpr int knight_y_incrs[8] = {2, 1, -1, -2, -2, -1,  1,  2};
+
+constexpr RayTable make_ray_table(const U8 *mask, const U8 *const *transforms,
+        const U8 *const *inverse_transforms) {
+
+    RayTable t;
+    for (int sq=0; sq<64; sq++) {
+        if (mask[sq] == 1) continue;
+        int q = mask[sq] - 2;
+        U8 p0 = inverse_transforms[q][sq];
+        t.rook[sq]   = make_rook_rays(mask, transforms[q], p0);
+        t.bishop[sq] = make_bishop_rays(mask, transforms[q], p0);
+        t.king[sq]   = make_step_mask(mask, sq, king_x_incrs, king_y_incrs);
+        t.knight[sq] = make_step_mask(mask, sq, knight_x_incrs, knight_y_incrs);
+        t.pawn[sq]   = make_pawn_mask(mask, transforms[q], p0);
+    }
+
+    for (int sq=0; sq<64; sq++) {
+        for (int tgt=0; tgt<64; tgt++) {
+            if (t.rook[sq].reach & sqbit(tgt))   t.rook_from[tgt]   |= sqbit(sq);
+            if (t.bishop[sq].reach & sqbit(tgt)) t.bishop_from[tgt] |= sqbit(sq);
+            if (t.pawn[sq] & sqbit(tgt))         t.pawn_from[tgt]   |= sqbit(sq);
+        }
+    }
+    return t;
+}
+
+constexpr const U8 *transforms_7x7[4] = {id_7x7, cw_90_7x7, cw_180_7x7, acw_90_7x7};
+constexpr const U8 *inverse_transforms_7x7[4] = {id_7x7, acw_90_7x7, cw_180_7x7, cw_90_7x7};
+constexpr const U8 *transforms_8x8[4] = {id_8x8, cw_90_8x8, cw_180_8x8, acw_90_8x8};
+constexpr const U8 *inverse_transforms_8x8[4] = {id_8x8, acw_90_8x8, cw_180_8x8, cw_90_8x8};
+
+// inline, so that every translation unit shares one copy of each table
+inline constexpr RayTable rays_7_3 = make_ray_table(board_7_3, transforms_7x7, inverse_transforms_7x7);
+inline constexpr RayTable rays_8_4 = make_ray_table(board_8_4, transforms_8x8, inverse_transforms_8x8);
+inline constexpr RayTable rays_8_2 = make_ray_table(board_8_2, transforms_8x8, inverse_transforms_8x8);
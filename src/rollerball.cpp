@@ -4,6 +4,8 @@
 #include "uciws.hpp"
 #include "board.hpp"
 #include "engine.hpp"
+#include "pst.hpp"
+#include "nnue.hpp"
 
 #define BOT_NAME "cs1200869"
 
@@ -11,15 +13,43 @@ int main(int argc, char** argv) {
 
     popl::OptionParser op("Rollerball");
     int port;
+    size_t hash_mb;
+    int n_threads;
+    std::string pst_file, pst_dump, eval_file;
+    bool ponder;
     auto port_op = op.add<popl::Value<int>>("p", "port", "port number", -1, &port);
+    op.add<popl::Value<size_t>>("", "hash", "transposition table size in MB", 64, &hash_mb);
+    op.add<popl::Value<int>>("", "threads", "number of search threads", 1, &n_threads);
+    op.add<popl::Switch>("", "ponder", "keep searching on the opponent's time", &ponder);
+    op.add<popl::Value<std::string>>("", "pst-file", "load the piece-square tables from a file", "", &pst_file);
+    op.add<popl::Value<std::string>>("", "eval-file", "load a neural network to evaluate with", "", &eval_file);
+    op.add<popl::Value<std::string>>("", "dump-pst", "write the built-in piece-square tables to a file and exit", "", &pst_dump);
     op.parse(argc, argv);
 
+    if (!pst_dump.empty()) {
+        if (!write_pst_file(pst_dump)) std::cout << "ERROR: could not write " << pst_dump << std::endl;
+        return 0;
+    }
+
     if (port == -1) {
         std::cout << "ERROR: port is a compulsory argument" << std::endl;
         return 0;
     }
 
-    UCIWSServer server(BOT_NAME, port);
+    if (n_threads < 1) {
+        std::cout << "ERROR: at least one search thread is needed" << std::endl;
+        return 0;
+    }
+
+    if (!pst_file.empty() && !load_pst_file(pst_file)) {
+        return 0;
+    }
+
+    if (!eval_file.empty() && !load_nnue_file(eval_file)) {
+        return 0;
+    }
+
+    UCIWSServer server(BOT_NAME, port, hash_mb, n_threads, ponder);
 
     server.start();
 
@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <cstring>
+
+#include "search.hpp"
+#include "movegen.hpp"
+#include "movepick.hpp"
+
+// Mate scores are stored in the transposition table relative to the node
+// they were found at, so they stay correct when reached at another ply.
+int score_to_tt(int score, int ply) {
+    if (score >= MATE_SCORE - MAX_PLY) return score + ply;
+    if (score <= -(MATE_SCORE - MAX_PLY)) return score - ply;
+    return score;
+}
+
+int score_from_tt(int score, int ply) {
+    if (score >= MATE_SCORE - MAX_PLY) return score - ply;
+    if (score <= -(MATE_SCORE - MAX_PLY)) return score + ply;
+    return score;
+}
+
+#define is_capture(b, m) ((b).data.board_0[getp1(m)] != 0)
+
+template <BoardType BT>
+Searcher<BT>::Searcher(const Board &b, TranspositionTable *tt, std::atomic<bool> *stop):
+    board(b), tt(tt), stop(stop) {
+
+    memset(this->killers, 0, sizeof(this->killers));
+    memset(this->history, 0, sizeof(this->history));
+    memset(this->pv_len, 0, sizeof(this->pv_len));
+}
+
+template <BoardType BT>
+int Searcher<BT>::evaluate() const {
+
+    // both kept up to date by make/unmake
+    const BoardData &d = this->board.data;
+    if (nnue_enabled) return nnue_evaluate(d.nnue, color_idx(d.player_to_play));
+    return d.player_to_play == WHITE ? d.psqt : -d.psqt;
+}
+
+template <BoardType BT>
+bool Searcher<BT>::should_stop() {
+
+    if (this->node_limit && this->nodes.load(std::memory_order_relaxed) >= this->node_limit) {
+        this->stop->store(true, std::memory_order_relaxed);
+    }
+    if (this->abort != nullptr && this->abort->load(std::memory_order_relaxed)) {
+        this->stop->store(true, std::memory_order_relaxed);
+    }
+    if (this->deadline != nullptr && (this->nodes.load(std::memory_order_relaxed) & 2047) == 0
+            && std::chrono::steady_clock::now() >= this->deadline->load(std::memory_order_relaxed)) {
+        this->stop->store(true, std::memory_order_relaxed);
+    }
+    return this->stop->load(std::memory_order_relaxed);
+}
+
+// Makes a pseudolegal move, and takes it back again if it leaves the mover's
+// king under threat.
+template <BoardType BT>
+bool Searcher<BT>::make_move(U16 move) {
+
+    PlayerColor color = this->board.data.player_to_play;
+    this->board.do_move_(move);
+
+    U8 king_pos = (color == WHITE) ? this->board.data.w_king : this->board.data.b_king;
+    if (king_pos != DEAD && square_attacked<BT>(this->board.data, king_pos, this->board.data.player_to_play)) {
+        this->board.undo_move_();
+        return false;
+    }
+
+    // single writer, so a plain load and store is enough
+    this->nodes.store(this->nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return true;
+}
+
+template <BoardType BT>
+void Searcher<BT>::update_pv(int ply, U16 move) {
+
+    this->pv[ply][0] = move;
+    memcpy(&this->pv[ply][1], &this->pv[ply+1][0], this->pv_len[ply+1] * sizeof(U16));
+    this->pv_len[ply] = this->pv_len[ply+1] + 1;
+}
+
+template <BoardType BT>
+int Searcher<BT>::search_root(int depth, int alpha, int beta) {
+
+    this->seldepth = 0;
+    this->age_history();
+    return this->search(alpha, beta, depth, 0);
+}
+
+template <BoardType BT>
+void Searcher<BT>::age_history() {
+
+    int *h = &this->history[0][0][0];
+    for (size_t i=0; i<sizeof(this->history) / sizeof(int); i++) h[i] /= 2;
+}
+
+template <BoardType BT>
+int Searcher<BT>::search(int alpha, int beta, int depth, int ply) {
+
+    this->pv_len[ply] = 0;
+    if (ply >= MAX_PLY) return this->evaluate();
+
+    bool in_check = king_attacked<BT>(this->board.data, this->board.data.player_to_play);
+    if (depth <= 0 && !in_check) return this->quiesce(alpha, beta, ply);
+    if (depth < 0) depth = 0;
+
+    if (ply > this->seldepth) this->seldepth = ply;
+    if (ply > 0 && this->should_stop()) return 0;
+    // a position seen before, in the game or on this line, is scored as the
+    // draw the repetition would come to
+    if (ply > 0 && this->board.repetitions() > 0) return 0;
+
+    bool pv_node = beta - alpha > 1;
+    U64 key = this->board.hash();
+    TTEntry entry;
+    U16 tt_move = 0;
+    if (this->tt->probe(key, entry)) {
+        tt_move = entry.move;
+        int score = score_from_tt(entry.score, ply);
+        if (ply > 0 && !pv_node && entry.depth >= depth) {
+            if (entry.bound == BOUND_EXACT) return score;
+            if (entry.bound == BOUND_LOWER && score >= beta) return score;
+            if (entry.bound == BOUND_UPPER && score <= alpha) return score;
+        }
+    }
+
+    // hash move, captures, killers, then quiet moves; see MovePicker
+    int c = color_idx(this->board.data.player_to_play);
+    MovePicker<BT> picker(this->board.data, tt_move, this->killers[ply], this->history[c]);
+
+    int alpha_orig = alpha;
+    int best_score = -INF_SCORE;
+    U16 best_move = 0;
+    int n_legal = 0;
+
+    U16 m;
+    while ((m = picker.next())) {
+        bool capture = is_capture(this->board, m);
+
+        if (!this->make_move(m)) continue;
+        n_legal++;
+
+        // check extension
+        int new_depth = depth - 1;
+        if (king_attacked<BT>(this->board.data, this->board.data.player_to_play)) new_depth++;
+
+        int score;
+        if (n_legal == 1) {
+            score = -this->search(-beta, -alpha, new_depth, ply+1);
+        }
+        else {
+            score = -this->search(-alpha-1, -alpha, new_depth, ply+1);
+            if (score > alpha && score < beta) {
+                score = -this->search(-beta, -alpha, new_depth, ply+1);
+            }
+        }
+
+        this->board.undo_move_();
+        if (this->stop->load(std::memory_order_relaxed)) return 0;
+
+        if (score > best_score) {
+            best_score = score;
+            best_move = m;
+            if (score > alpha) {
+                alpha = score;
+                this->update_pv(ply, m);
+                if (score >= beta) {
+                    if (!capture && !getpromo(m)) {
+                        if (this->killers[ply][0] != m) {
+                            this->killers[ply][1] = this->killers[ply][0];
+                            this->killers[ply][0] = m;
+                        }
+                        int &h = this->history[c][getp0(m)][getp1(m)];
+                        h += depth * depth;
+                        if (h > HISTORY_MAX) this->age_history();
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    // checkmate or stalemate
+    if (n_legal == 0) {
+        return in_check ? -MATE_SCORE + ply : 0;
+    }
+
+    Bound bound = best_score >= beta ? BOUND_LOWER :
+                  best_score > alpha_orig ? BOUND_EXACT : BOUND_UPPER;
+    this->tt->store(key, depth, bound, score_to_tt(best_score, ply), best_move);
+
+    return best_score;
+}
+
+template <BoardType BT>
+int Searcher<BT>::quiesce(int alpha, int beta, int ply) {
+
+    this->pv_len[ply] = 0;
+    if (ply > this->seldepth) this->seldepth = ply;
+    if (ply >= MAX_PLY) return this->evaluate();
+    if (this->should_stop()) return 0;
+
+    bool in_check = king_attacked<BT>(this->board.data, this->board.data.player_to_play);
+    int best_score = -INF_SCORE;
+
+    if (!in_check) {
+        best_score = this->evaluate();
+        if (best_score >= beta) return best_score;
+        if (best_score > alpha) alpha = best_score;
+    }
+
+    // captures and promotions only, unless every evasion has to be tried
+    static const U16 no_killers[2] = {0, 0};
+    int c = color_idx(this->board.data.player_to_play);
+    MovePicker<BT> picker = in_check
+        ? MovePicker<BT>(this->board.data, 0, no_killers, this->history[c])
+        : MovePicker<BT>(this->board.data);
+    int n_legal = 0;
+
+    U16 m;
+    while ((m = picker.next())) {
+
+        if (!this->make_move(m)) continue;
+        n_legal++;
+
+        int score = -this->quiesce(-beta, -alpha, ply+1);
+
+        this->board.undo_move_();
+        if (this->stop->load(std::memory_order_relaxed)) return 0;
+
+        if (score > best_score) {
+            best_score = score;
+            if (score > alpha) {
+                alpha = score;
+                this->update_pv(ply, m);
+                if (score >= beta) break;
+            }
+        }
+    }
+
+    if (in_check && n_legal == 0) return -MATE_SCORE + ply;
+
+    return best_score;
+}
+
+// the searches of the three layouts are all built here
+template class Searcher<SEVEN_THREE>;
+template class Searcher<EIGHT_FOUR>;
+template class Searcher<EIGHT_TWO>;
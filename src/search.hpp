@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include "board.hpp"
+#include "tt.hpp"
+
+#define MAX_PLY 64
+#define INF_SCORE 32000
+#define MATE_SCORE 30000
+#define is_mate_score(s) ((s) >= MATE_SCORE - MAX_PLY || (s) <= -(MATE_SCORE - MAX_PLY))
+
+// History scores are halved before every iteration, and at once whenever one
+// of them grows past this, so that they favour recent cutoffs and stay far
+// from overflowing in long searches.
+#define HISTORY_MAX (1 << 20)
+
+/**
+ * The state of one search: a private copy of the board that is searched with
+ * do_move_ / undo_move_, the move ordering heuristics and the principal
+ * variation. The search is compiled once per board layout, so that move
+ * generation and attack tests inside it work on constant tables.
+ */
+template <BoardType BT>
+class Searcher {
+
+    public:
+
+    Board board;
+    TranspositionTable *tt;
+    std::atomic<bool> *stop;
+
+    // Time at which the search raises the stop flag itself, or nullptr to
+    // only watch the flag. It may be moved while the search runs.
+    const std::atomic<std::chrono::steady_clock::time_point> *deadline = nullptr;
+
+    // Number of nodes at which the search raises the stop flag, or 0.
+    uint64_t node_limit = 0;
+
+    // Flag raised from outside the engine to abort the search, or nullptr.
+    // The search raises its own stop flag when it sees it, and never lowers
+    // it.
+    const std::atomic<bool> *abort = nullptr;
+
+    // Only the owning thread writes the count, other threads may read it
+    // while the search runs.
+    std::atomic<uint64_t> nodes{0};
+    int seldepth = 0;
+
+    U16 killers[MAX_PLY][2];
+    int history[2][64][64];
+
+    U16 pv[MAX_PLY+1][MAX_PLY+1];
+    int pv_len[MAX_PLY+1];
+
+    /**
+     * Constructor - prepares a search of the given position.
+     * @param b - the position to search; it is copied.
+     * @param tt - the transposition table to use.
+     * @param stop - flag that aborts the search once set.
+     */
+    Searcher(const Board &b, TranspositionTable *tt, std::atomic<bool> *stop);
+
+    /**
+     * Searches the root position to a fixed depth.
+     * @param depth - the depth to search to.
+     * @param alpha - lower bound of the search window.
+     * @param beta - upper bound of the search window.
+     * @return the score of the position from the side to move's view. The
+     * result is meaningless if the search was aborted.
+     */
+    int search_root(int depth, int alpha, int beta);
+
+    /**
+     * Principal variation alpha-beta search.
+     * @return the score of the position from the side to move's view.
+     */
+    int search(int alpha, int beta, int depth, int ply);
+
+    /**
+     * Quiescence search over captures and promotions (and all evasions when
+     * in check).
+     * @return the score of the position from the side to move's view.
+     */
+    int quiesce(int alpha, int beta, int ply);
+
+    /**
+     * Static evaluation of the position.
+     * @return the score of the position from the side to move's view.
+     */
+    int evaluate() const;
+
+    /**
+     * @return true if the search has to stop, checking the node limit and
+     * the abort flag at every node and the clock every few thousand nodes.
+     */
+    bool should_stop();
+
+    private:
+
+    bool make_move(U16 move);
+    void update_pv(int ply, U16 move);
+    void age_history();
+};
@@ -0,0 +1,54 @@
+#include "threadpool.hpp"
+
+ThreadPool::ThreadPool(int n_threads) {
+    for (int i=0; i<n_threads; i++) {
+        this->workers.emplace_back(&ThreadPool::worker_loop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->quit = true;
+    }
+    this->job_added.notify_all();
+    for (auto &t : this->workers) t.join();
+}
+
+void ThreadPool::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->jobs.push_back(std::move(job));
+    }
+    this->job_added.notify_one();
+}
+
+void ThreadPool::worker_loop() {
+
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->job_added.wait(lock, [this]() { return this->quit || !this->jobs.empty(); });
+            if (this->jobs.empty()) return;
+            job = std::move(this->jobs.front());
+            this->jobs.pop_front();
+        }
+        job();
+    }
+}
+
+void WaitGroup::add(int n) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->count += n;
+}
+
+void WaitGroup::done() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (--this->count == 0) this->all_done.notify_all();
+}
+
+void WaitGroup::wait() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->all_done.wait(lock, [this]() { return this->count == 0; });
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads, started once, that run jobs from a queue in
+ * the order they were submitted. The server runs every search (and its Lazy
+ * SMP helpers) on it, so no thread is created per move and the message
+ * handler never waits for a search.
+ */
+class ThreadPool {
+
+    public:
+
+    /**
+     * Constructor - starts the workers.
+     * @param n_threads - number of worker threads.
+     */
+    ThreadPool(int n_threads);
+
+    /**
+     * Destructor - lets the workers finish the queued jobs, then joins them.
+     */
+    ~ThreadPool();
+
+    /**
+     * Queues a job for the next idle worker.
+     * @param job - the job to run.
+     */
+    void submit(std::function<void()> job);
+
+    private:
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable job_added;
+    bool quit = false;
+
+    void worker_loop();
+};
+
+/**
+ * Counts jobs in flight so that their submitter can wait for all of them.
+ */
+class WaitGroup {
+
+    public:
+
+    /**
+     * Registers jobs that are about to be submitted.
+     * @param n - number of jobs.
+     */
+    void add(int n = 1);
+
+    /**
+     * Marks one job as finished; called by the job itself.
+     */
+    void done();
+
+    /**
+     * Blocks until every registered job has finished.
+     */
+    void wait();
+
+    private:
+
+    std::mutex mutex;
+    std::condition_variable all_done;
+    int count = 0;
+};
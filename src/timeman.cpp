@@ -0,0 +1,36 @@
+#include <algorithm>
+
+#include "timeman.hpp"
+
+// Pieces on the board at the start of a game, indexed by board type.
+static const int start_pieces[4] = {0, 12, 16, 20};
+
+TimeBudget compute_time_budget(std::chrono::milliseconds time_left, const Board &b) {
+
+    const BoardData &d = b.data;
+    int pieces = popcount(d.color_bb[0] | d.color_bb[1]);
+
+    // games run longer on the bigger layouts, and fewer moves are left once
+    // pieces have come off
+    int moves_to_go = 12 + 24 * pieces / start_pieces[d.board_type];
+
+    // every remaining move pays the overhead, not just this one, but the
+    // reserve for it never takes more than half the clock: otherwise a low
+    // clock would leave nothing to think with for the rest of the game
+    int64_t reserve = std::min<int64_t>(MOVE_OVERHEAD_MS * moves_to_go, time_left.count() / 2);
+    int64_t available = std::max<int64_t>(time_left.count() - reserve, 0);
+    int64_t optimum = available / moves_to_go;
+
+    // iterations overshoot the soft limit by the effective branching factor,
+    // so the average move ends up close to the optimum
+    int64_t soft = optimum / 2;
+    int64_t hard = std::min(optimum * 3, available / 4);
+
+    // don't let the budget shrink below the overhead of a move while the
+    // clock allows it; on a nearly empty clock take a quarter of what is left
+    soft = std::max<int64_t>(soft, std::min<int64_t>(MOVE_OVERHEAD_MS, available / 4));
+    soft = std::max<int64_t>(soft, 1);
+    hard = std::max<int64_t>(hard, soft);
+
+    return {std::chrono::milliseconds(soft), std::chrono::milliseconds(hard)};
+}
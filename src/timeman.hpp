@@ -0,0 +1,28 @@
+#pragma once
+
+#include <chrono>
+#include "board.hpp"
+
+// Time lost between the UI reading its clock and our bestmove reaching it:
+// the WebSocket round trip, thread start-up and the final iteration unwinding.
+#define MOVE_OVERHEAD_MS 50
+
+/**
+ * How long to think about one move. The search does not start a new
+ * iteration once the soft limit has passed, and is aborted through the stop
+ * flag at the hard limit.
+ */
+struct TimeBudget {
+    std::chrono::milliseconds soft;
+    std::chrono::milliseconds hard;
+};
+
+/**
+ * @brief Splits the remaining clock over the moves that are likely left in
+ * the game.
+ * @param time_left - time left on our clock, as sent with the go command.
+ * @param b - the position to move in; its board type and piece count give
+ * the phase of the game.
+ * @return the soft and hard limits for this move.
+ */
+TimeBudget compute_time_budget(std::chrono::milliseconds time_left, const Board &b);
@@ -0,0 +1,590 @@
+#include <popl.hpp>
+#include <websocketpp/config/asio_no_tls_client.hpp>
+#include <websocketpp/client.hpp>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#include <sys/prctl.h>
+#endif
+
+#include "board.hpp"
+#include "butils.hpp"
+#include "game.hpp"
+
+typedef websocketpp::client<websocketpp::config::asio_client> WSClient;
+
+/**
+ * An engine process started for one game slot, and our WebSocket connection
+ * to it. The client runs on a thread of its own that queues the engine's
+ * messages, so a game can be driven with blocking calls.
+ */
+class EngineProcess {
+
+    public:
+
+    /**
+     * Constructor - starts the engine.
+     * @param path - the engine binary.
+     * @param args - extra arguments, separated by spaces.
+     * @param port - the port the engine listens on.
+     * @param first_cpu - the first of the CPUs to pin the engine to, or -1.
+     * @param n_cpus - the number of CPUs, from first_cpu on.
+     */
+    EngineProcess(const std::string &path, const std::string &args, int port, int first_cpu, int n_cpus);
+
+    /**
+     * Destructor - closes the connection and terminates the engine.
+     */
+    ~EngineProcess();
+
+    /**
+     * Connects to the engine, retrying while it starts up.
+     * @return true once connected.
+     */
+    bool connect();
+
+    void send(const std::string &msg);
+
+    /**
+     * Waits for a message starting with the given word; earlier messages
+     * are dropped.
+     * @param word - the first word of the message, such as bestmove.
+     * @param timeout - how long to wait.
+     * @param msg - the message.
+     * @return false on a timeout or if the connection was closed.
+     */
+    bool wait_for(const std::string &word, std::chrono::milliseconds timeout, std::string &msg);
+
+    /**
+     * @return true if the connection was closed by the engine.
+     */
+    bool closed();
+
+    private:
+
+    pid_t pid = -1;
+    int port;
+    WSClient client;
+    std::thread io_thread;
+    websocketpp::connection_hdl hdl;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::string> inbox;
+    bool is_open = false, failed = false, is_closed = false;
+};
+
+EngineProcess::EngineProcess(const std::string &path, const std::string &args, int port, int first_cpu, int n_cpus) {
+
+    this->port = port;
+
+    // everything the child needs is prepared before forking
+    std::vector<std::string> argv_s = {path, "--port", std::to_string(port)};
+    std::istringstream iss(args);
+    std::string arg;
+    while (iss >> arg) argv_s.push_back(arg);
+    std::vector<char*> argv;
+    for (auto &s : argv_s) argv.push_back(&s[0]);
+    argv.push_back(nullptr);
+
+    this->pid = fork();
+    if (this->pid == 0) {
+#ifdef __linux__
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        if (first_cpu >= 0) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            for (int cpu=first_cpu; cpu<first_cpu+n_cpus; cpu++) CPU_SET(cpu, &cpus);
+            sched_setaffinity(0, sizeof(cpus), &cpus);
+        }
+#endif
+        int devnull = open("/dev/null", O_WRONLY);
+        dup2(devnull, STDOUT_FILENO);
+        dup2(devnull, STDERR_FILENO);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+
+    this->client.clear_access_channels(websocketpp::log::alevel::all);
+    this->client.clear_error_channels(websocketpp::log::elevel::all);
+    this->client.init_asio();
+    this->client.start_perpetual();
+    this->io_thread = std::thread([this]() { this->client.run(); });
+}
+
+EngineProcess::~EngineProcess() {
+
+    this->client.stop_perpetual();
+    this->client.stop();
+    this->io_thread.join();
+
+    if (this->pid > 0) {
+        kill(this->pid, SIGTERM);
+        waitpid(this->pid, nullptr, 0);
+    }
+}
+
+bool EngineProcess::connect() {
+
+    for (int attempt=0; attempt<100; attempt++) {
+        if (this->pid <= 0 || waitpid(this->pid, nullptr, WNOHANG) != 0) return false;
+
+        websocketpp::lib::error_code ec;
+        auto con = this->client.get_connection("ws://localhost:" + std::to_string(this->port), ec);
+        if (ec) return false;
+
+        con->set_open_handler([this](websocketpp::connection_hdl hdl) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->hdl = hdl;
+            this->is_open = true;
+            this->changed.notify_all();
+        });
+        con->set_fail_handler([this](websocketpp::connection_hdl) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->failed = true;
+            this->changed.notify_all();
+        });
+        con->set_close_handler([this](websocketpp::connection_hdl) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->is_closed = true;
+            this->changed.notify_all();
+        });
+        con->set_message_handler([this](websocketpp::connection_hdl, WSClient::message_ptr msg) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->inbox.push_back(msg->get_payload());
+            this->changed.notify_all();
+        });
+        this->client.connect(con);
+
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->changed.wait(lock, [this]() { return this->is_open || this->failed; });
+            if (this->is_open) return true;
+            this->failed = false;
+        }
+        // the engine is still starting up
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return false;
+}
+
+void EngineProcess::send(const std::string &msg) {
+    websocketpp::lib::error_code ec;
+    this->client.send(this->hdl, msg, websocketpp::frame::opcode::text, ec);
+}
+
+bool EngineProcess::wait_for(const std::string &word, std::chrono::milliseconds timeout, std::string &msg) {
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true) {
+        while (!this->inbox.empty()) {
+            std::string m = this->inbox.front();
+            this->inbox.pop_front();
+            if (m.compare(0, word.size(), word) == 0) {
+                msg = m;
+                return true;
+            }
+        }
+        if (this->is_closed) return false;
+        if (this->changed.wait_until(lock, deadline) == std::cv_status::timeout && this->inbox.empty()) {
+            return false;
+        }
+    }
+}
+
+bool EngineProcess::closed() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->is_closed;
+}
+
+struct Settings {
+    std::string engine[2], args[2];
+    int threads[2];     // search threads of each engine, from its --threads
+    bool ponder[2];     // whether each engine has --ponder
+    std::vector<BoardType> btypes;
+    int n_games, concurrency, time_ms, max_plies, random_plies, base_port;
+    unsigned seed;
+    bool pin;
+
+    // SPRT of H0: elo = elo0 against H1: elo = elo1, for engine A
+    bool sprt;
+    double elo0, elo1, alpha, beta;
+};
+
+struct GameResult {
+    double points = 0.5;    // scored by engine A
+    std::string result, reason;
+    int plies = 0;
+    bool crashed = false;
+};
+
+// The state shared by the game slots.
+struct Tournament {
+    Settings settings;
+    std::atomic<int> next_game{0};
+    std::atomic<bool> stop{false};
+    bool failed = false;
+
+    // set when the SPRT stops the tournament; games that were already
+    // running still finish and count towards the score
+    std::string verdict;
+
+    std::mutex mutex;
+    Score total;
+    std::vector<Score> per_type;
+};
+
+static double score_to_elo(double score) {
+    score = std::min(std::max(score, 0.001), 0.999);
+    return 400 * std::log10(score / (1 - score));
+}
+
+static double elo_to_score(double elo) {
+    return 1 / (1 + std::pow(10, -elo / 400));
+}
+
+// Variance of the points of a single game.
+static double score_variance(const Score &s) {
+    double m = s.mean();
+    return (s.wins * (1 - m) * (1 - m) + s.draws * (0.5 - m) * (0.5 - m) + s.losses * m * m) / s.games();
+}
+
+// Elo difference and the half-width of its 95% confidence interval.
+static void elo_estimate(const Score &s, double &elo, double &margin) {
+
+    elo = score_to_elo(s.mean());
+    double stderr_ = std::sqrt(score_variance(s) / s.games());
+    margin = (score_to_elo(s.mean() + 1.96 * stderr_) - score_to_elo(s.mean() - 1.96 * stderr_)) / 2;
+}
+
+// Log-likelihood ratio of H1 against H0, in the normal approximation of the
+// generalized SPRT.
+static double sprt_llr(const Score &s, double elo0, double elo1) {
+
+    double var = score_variance(s);
+    if (var <= 0) return 0;
+    double s0 = elo_to_score(elo0), s1 = elo_to_score(elo1);
+    return s.games() * (s1 - s0) * (2 * s.mean() - s0 - s1) / (2 * var);
+}
+
+// Plays one game, with engines[first] as white, from an opening of random
+// moves. The engines keep the clock like the UI does: a move's time runs
+// from sending go until the bestmove arrives.
+GameResult play_game(EngineProcess *engines[2], int first, BoardType btype, const Settings &s,
+                     std::mt19937 &rng) {
+
+    GameResult r;
+    std::string msg;
+    std::string newgame = "ucinewgame " + board_type_to_str(btype) + " " + std::to_string(s.time_ms);
+    for (int i=0; i<2; i++) {
+        engines[i]->send(newgame);
+        if (!engines[i]->wait_for("newgameok", std::chrono::seconds(10), msg)) {
+            r.crashed = true;
+            r.reason = "no reply to ucinewgame";
+            return r;
+        }
+    }
+
+    // indexed by color_idx
+    int player_of[2] = {first, first ^ 1};
+    int clock_ms[2] = {s.time_ms, s.time_ms};
+
+    Board b(btype);
+    std::string moves;
+    for (int i=0; i<s.random_plies && game_status(b, s.max_plies) == GAME_ONGOING; i++) {
+        MoveList legal;
+        b.generate_legal(legal);
+        U16 m = legal[rng() % legal.size()];
+        moves += " " + move_to_str(m);
+        b.do_move_(m);
+    }
+
+    GameStatus status;
+    int winner = -1;
+    while ((status = game_status(b, s.max_plies)) == GAME_ONGOING) {
+
+        int side = color_idx(b.data.player_to_play);
+        EngineProcess *e = engines[player_of[side]];
+        e->send("position startpos moves" + moves);
+        e->send("go " + std::to_string(clock_ms[side]));
+
+        auto start = std::chrono::steady_clock::now();
+        bool replied = e->wait_for("bestmove", std::chrono::milliseconds(clock_ms[side] + 2000), msg);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        clock_ms[side] -= (int)std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+
+        if (!replied && e->closed()) {
+            r.crashed = true;
+            r.reason = "engine " + std::string(player_of[side] == 0 ? "A" : "B") + " disconnected";
+            return r;
+        }
+        if (!replied || clock_ms[side] < 0) {
+            // take back the late answer before the next game starts
+            if (!replied) {
+                e->send("stop");
+                e->wait_for("bestmove", std::chrono::seconds(5), msg);
+            }
+            winner = player_of[side ^ 1];
+            r.reason = "time forfeit";
+            break;
+        }
+
+        std::string ms = msg.size() > 9 ? msg.substr(9) : "";
+        U16 m = str_to_move(ms);
+        MoveList legal;
+        b.generate_legal(legal);
+        if (!legal.contains(m)) {
+            winner = player_of[side ^ 1];
+            r.reason = "illegal move " + ms;
+            break;
+        }
+        moves += " " + ms;
+        b.do_move_(m);
+    }
+
+    if (status == GAME_CHECKMATE) {
+        winner = player_of[color_idx(b.data.player_to_play) ^ 1];
+    }
+    if (r.reason.empty()) r.reason = game_status_to_str(status);
+
+    r.result = winner < 0 ? "1/2-1/2" : winner == first ? "1-0" : "0-1";
+    r.points = winner < 0 ? 0.5 : winner == 0 ? 1 : 0;
+    r.plies = b.n_undo;
+    return r;
+}
+
+// Adds a game to the results and decides whether the SPRT has finished.
+void record_game(Tournament &t, int game_no, BoardType btype, int first, const GameResult &r) {
+
+    std::lock_guard<std::mutex> lock(t.mutex);
+    const Settings &s = t.settings;
+
+    t.total.add(r.points);
+    for (size_t i=0; i<s.btypes.size(); i++) {
+        if (s.btypes[i] == btype) t.per_type[i].add(r.points);
+    }
+
+    double elo, margin;
+    elo_estimate(t.total, elo, margin);
+    std::ostringstream line;
+    line.setf(std::ios::fixed);
+    line.precision(1);
+    line << "game " << game_no + 1 << " " << board_type_to_str(btype) << ": "
+         << (first == 0 ? "A - B " : "B - A ") << r.result << " (" << r.reason << ", " << r.plies << " plies)"
+         << " | " << t.total << " elo " << elo << " +/- " << margin;
+
+    if (s.sprt) {
+        double llr = sprt_llr(t.total, s.elo0, s.elo1);
+        double lower = std::log(s.beta / (1 - s.alpha)), upper = std::log((1 - s.beta) / s.alpha);
+        line.precision(2);
+        line << " llr " << llr << " [" << lower << ", " << upper << "]";
+        if (!t.stop && (llr <= lower || llr >= upper)) {
+            t.stop = true;
+            t.verdict = std::string(llr >= upper ? "H1" : "H0") + " accepted after "
+                      + std::to_string(t.total.games()) + " games";
+            line << "\nSPRT: " << t.verdict;
+        }
+    }
+    std::cout << line.str() << std::endl;
+}
+
+// The number of search threads the engine is started with, from a --threads
+// in its extra arguments.
+static int engine_threads(const std::string &args) {
+    std::istringstream iss(args);
+    std::string arg;
+    int threads = 1;
+    while (iss >> arg) {
+        if (arg == "--threads" && iss >> arg) threads = std::max(1, atoi(arg.c_str()));
+        else if (arg.rfind("--threads=", 0) == 0) threads = std::max(1, atoi(arg.c_str() + 10));
+    }
+    return threads;
+}
+
+// Whether an engine ponders, going by its --ponder argument.
+static bool engine_ponders(const std::string &args) {
+    std::istringstream iss(args);
+    std::string arg;
+    while (iss >> arg) {
+        if (arg == "--ponder") return true;
+    }
+    return false;
+}
+
+// One game slot: a pair of engines that plays games until none are left.
+// Slot k's engines listen on base_port + 2k and base_port + 2k + 1.
+void run_slot(Tournament &t, int k) {
+
+    const Settings &s = t.settings;
+
+    // pinned, the slot owns threads[0] + threads[1] CPUs: A's come first
+    int first_cpu[2] = {-1, -1};
+    if (s.pin) {
+        first_cpu[0] = k * (s.threads[0] + s.threads[1]);
+        first_cpu[1] = first_cpu[0] + s.threads[0];
+    }
+
+    std::unique_ptr<EngineProcess> processes[2];
+    EngineProcess *engines[2];
+    for (int i=0; i<2; i++) {
+        processes[i].reset(new EngineProcess(s.engine[i], s.args[i], s.base_port + 2 * k + i,
+                                             first_cpu[i], s.threads[i]));
+        engines[i] = processes[i].get();
+    }
+
+    std::string msg;
+    for (int i=0; i<2; i++) {
+        if (!engines[i]->connect()) {
+            std::cout << "ERROR: could not connect to " << s.engine[i] << " on port "
+                      << s.base_port + 2 * k + i << std::endl;
+            std::lock_guard<std::mutex> lock(t.mutex);
+            t.failed = t.stop = true;
+            return;
+        }
+        engines[i]->send("uci");
+        engines[i]->wait_for("uciok", std::chrono::seconds(10), msg);
+    }
+
+    while (!t.stop) {
+        int g = t.next_game++;
+        if (g >= s.n_games) break;
+
+        // both games of a pair play the same opening and board type, with
+        // the colours reversed
+        int pair = g / 2;
+        BoardType btype = s.btypes[pair % s.btypes.size()];
+        std::mt19937 rng(s.seed + pair);
+        GameResult r = play_game(engines, g % 2, btype, s, rng);
+
+        if (r.crashed) {
+            std::cout << "ERROR: game " << g + 1 << ": " << r.reason << std::endl;
+            std::lock_guard<std::mutex> lock(t.mutex);
+            t.failed = t.stop = true;
+            return;
+        }
+        record_game(t, g, btype, g % 2, r);
+    }
+}
+
+int main(int argc, char** argv) {
+
+    popl::OptionParser op("Rollerball tournament");
+    Tournament t;
+    Settings &s = t.settings;
+    std::string type_str;
+    auto help_op = op.add<popl::Switch>("h", "help", "produce help message");
+    op.add<popl::Value<std::string>>("", "engine-a", "engine A binary", "bin/rollerball", &s.engine[0]);
+    op.add<popl::Value<std::string>>("", "engine-b", "engine B binary", "bin/rollerball", &s.engine[1]);
+    op.add<popl::Value<std::string>>("", "args-a", "extra arguments of engine A", "", &s.args[0]);
+    op.add<popl::Value<std::string>>("", "args-b", "extra arguments of engine B", "", &s.args[1]);
+    op.add<popl::Value<std::string>>("t", "type", "board type (board-7-3, board-8-4, board-8-2 or all)", "all", &type_str);
+    op.add<popl::Value<int>>("n", "games", "maximum number of games", 1000, &s.n_games);
+    op.add<popl::Value<int>>("c", "concurrency", "number of games played at once (0 for as many as the CPUs allow)", 0, &s.concurrency);
+    op.add<popl::Value<int>>("", "time", "time per side per game in ms", 10000, &s.time_ms);
+    op.add<popl::Value<int>>("", "max-plies", "adjudicate a draw after this many plies (0 for none)", 300, &s.max_plies);
+    op.add<popl::Value<int>>("", "random-plies", "random moves played before the engines take over", 4, &s.random_plies);
+    op.add<popl::Value<unsigned>>("", "seed", "seed of the random openings", 1, &s.seed);
+    op.add<popl::Value<int>>("", "port", "first port of the engines", 9000, &s.base_port);
+    op.add<popl::Switch>("", "pin", "pin each engine to CPUs of its own, one per search thread", &s.pin);
+    op.add<popl::Switch>("", "sprt", "stop once the SPRT accepts or rejects elo1 over elo0", &s.sprt);
+    op.add<popl::Value<double>>("", "elo0", "Elo of A over B under H0", 0, &s.elo0);
+    op.add<popl::Value<double>>("", "elo1", "Elo of A over B under H1", 5, &s.elo1);
+    op.add<popl::Value<double>>("", "alpha", "probability of accepting H1 when H0 holds", 0.05, &s.alpha);
+    op.add<popl::Value<double>>("", "beta", "probability of accepting H0 when H1 holds", 0.05, &s.beta);
+    op.parse(argc, argv);
+
+    if (help_op->is_set()) {
+        std::cout << op << std::endl;
+        return 0;
+    }
+
+    if (type_str == "all") {
+        s.btypes = {SEVEN_THREE, EIGHT_FOUR, EIGHT_TWO};
+    }
+    else {
+        BoardType btype;
+        if (!parse_board_type(type_str, btype)) {
+            std::cout << "ERROR: unknown board type " << type_str << std::endl;
+            return 1;
+        }
+        s.btypes = {btype};
+    }
+    t.per_type.resize(s.btypes.size());
+
+    for (int i=0; i<2; i++) {
+        s.threads[i] = engine_threads(s.args[i]);
+        s.ponder[i] = engine_ponders(s.args[i]);
+    }
+
+    // the engines of a slot take turns searching, so it needs a CPU per
+    // search thread of the larger one; both search at once when one of them
+    // ponders, and pinned each engine owns its CPUs anyway
+    int n_cpus = std::max(1u, std::thread::hardware_concurrency());
+    int slot_cpus = std::max(s.threads[0], s.threads[1]);
+    if (s.pin || s.ponder[0] || s.ponder[1]) slot_cpus = s.threads[0] + s.threads[1];
+    if (s.concurrency <= 0) s.concurrency = std::max(1, n_cpus / slot_cpus);
+    s.concurrency = std::min(s.concurrency, std::max(s.n_games, 1));
+    if (s.concurrency * slot_cpus > n_cpus) {
+        if (s.pin) {
+            std::cout << "ERROR: " << s.concurrency << " pinned slots need " << s.concurrency * slot_cpus
+                      << " CPUs, but there are " << n_cpus << std::endl;
+            return 1;
+        }
+        std::cout << "WARNING: " << s.concurrency << " slots search with up to " << s.concurrency * slot_cpus
+                  << " threads on " << n_cpus << " CPUs, so the engines get less time than their clocks say"
+                  << std::endl;
+    }
+
+    // a slot that stops writes to a closed connection
+    signal(SIGPIPE, SIG_IGN);
+
+    std::vector<std::thread> slots;
+    for (int k=0; k<s.concurrency; k++) {
+        slots.emplace_back(run_slot, std::ref(t), k);
+    }
+    for (auto &slot : slots) slot.join();
+
+    if (t.total.games() == 0) return 1;
+
+    double elo, margin;
+    elo_estimate(t.total, elo, margin);
+    std::cout.setf(std::ios::fixed);
+    std::cout.precision(1);
+    std::cout << "\nResults for A (" << s.engine[0] << (s.args[0].empty() ? "" : " ") << s.args[0]
+              << ") against B (" << s.engine[1] << (s.args[1].empty() ? "" : " ") << s.args[1] << "):\n";
+    for (size_t i=0; i<s.btypes.size(); i++) {
+        std::cout << "  " << board_type_to_str(s.btypes[i]) << ": " << t.per_type[i] << "\n";
+    }
+    std::cout << "  total: " << t.total << "\n"
+              << "  elo " << elo << " +/- " << margin << " (95%)" << std::endl;
+
+    if (s.sprt) {
+        double llr = sprt_llr(t.total, s.elo0, s.elo1);
+        double lower = std::log(s.beta / (1 - s.alpha)), upper = std::log((1 - s.beta) / s.alpha);
+        std::cout.precision(2);
+        std::cout << "  sprt [" << s.elo0 << ", " << s.elo1 << "]: llr " << llr << " ["
+                  << lower << ", " << upper << "], "
+                  << (t.verdict.empty() ? "inconclusive" : t.verdict) << std::endl;
+    }
+
+    return t.failed ? 1 : 0;
+}
@@ -0,0 +1,120 @@
+#include "tt.hpp"
+
+// Layout of the data word of a slot:
+//   bits  0-15  move
+//   bits 16-31  score (as int16)
+//   bits 32-39  depth (as int8)
+//   bits 40-41  bound
+//   bits 48-55  generation
+#define tt_pack(move, score, depth, bound, gen) \
+    ((U64)(move) | ((U64)(U16)(int16_t)(score) << 16) | ((U64)(U8)(int8_t)(depth) << 32) | \
+     ((U64)(bound) << 40) | ((U64)(gen) << 48))
+#define tt_move(d)  ((U16)((d) & 0xffff))
+#define tt_score(d) ((int)(int16_t)(((d) >> 16) & 0xffff))
+#define tt_depth(d) ((int)(int8_t)(((d) >> 32) & 0xff))
+#define tt_bound(d) ((Bound)(((d) >> 40) & 0x3))
+#define tt_gen(d)   ((U8)(((d) >> 48) & 0xff))
+
+TranspositionTable::TranspositionTable(size_t mb) {
+    this->resize(mb);
+}
+
+TranspositionTable::~TranspositionTable() {
+    delete[] this->buckets;
+}
+
+void TranspositionTable::resize(size_t mb) {
+
+    U64 n = 1;
+    while ((n << 1) * sizeof(Bucket) <= mb * 1024 * 1024) n <<= 1;
+
+    delete[] this->buckets;
+    this->buckets = new Bucket[n];
+    this->n_buckets = n;
+    this->clear();
+}
+
+void TranspositionTable::clear() {
+
+    for (U64 i=0; i<this->n_buckets; i++) {
+        for (auto &slot : this->buckets[i].slots) {
+            slot.key_xor_data.store(0, std::memory_order_relaxed);
+            slot.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    this->generation = 0;
+}
+
+void TranspositionTable::new_search() {
+    this->generation++;
+}
+
+bool TranspositionTable::probe(U64 key, TTEntry &entry) const {
+
+    const Bucket &bucket = this->buckets[key & (this->n_buckets - 1)];
+
+    for (auto &slot : bucket.slots) {
+        U64 data = slot.data.load(std::memory_order_relaxed);
+        U64 key_xor_data = slot.key_xor_data.load(std::memory_order_relaxed);
+        if ((key_xor_data ^ data) != key || tt_bound(data) == BOUND_NONE) continue;
+
+        entry.move = tt_move(data);
+        entry.score = tt_score(data);
+        entry.depth = tt_depth(data);
+        entry.bound = tt_bound(data);
+        return true;
+    }
+
+    return false;
+}
+
+void TranspositionTable::store(U64 key, int depth, Bound bound, int score, U16 move) {
+
+    Bucket &bucket = this->buckets[key & (this->n_buckets - 1)];
+
+    // Reuse the slot holding this position if there is one, otherwise
+    // replace the slot with the least depth, counting entries from older
+    // searches as shallower.
+    Slot *replace = nullptr;
+    int replace_value = 1 << 30;
+    U64 old_data = 0;
+
+    for (auto &slot : bucket.slots) {
+        U64 data = slot.data.load(std::memory_order_relaxed);
+        U64 key_xor_data = slot.key_xor_data.load(std::memory_order_relaxed);
+
+        if ((key_xor_data ^ data) == key) {
+            replace = &slot;
+            old_data = data;
+            break;
+        }
+
+        int age = (U8)(this->generation - tt_gen(data));
+        int value = tt_depth(data) - 8 * age;
+        if (tt_bound(data) == BOUND_NONE) value = -(1 << 20);
+        if (value < replace_value) {
+            replace = &slot;
+            replace_value = value;
+        }
+    }
+
+    // Keep the move of a previous search of this position if we have none.
+    if (old_data && move == 0) move = tt_move(old_data);
+
+    U64 data = tt_pack(move, score, depth, bound, this->generation);
+    replace->key_xor_data.store(key ^ data, std::memory_order_relaxed);
+    replace->data.store(data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const {
+
+    U64 n = this->n_buckets < 250 ? this->n_buckets : 250;
+    int used = 0;
+    for (U64 i=0; i<n; i++) {
+        for (auto &slot : this->buckets[i].slots) {
+            U64 data = slot.data.load(std::memory_order_relaxed);
+            if (tt_bound(data) != BOUND_NONE && tt_gen(data) == this->generation) used++;
+        }
+    }
+    return (int)(used * 1000 / (n * 4));
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include "constants.hpp"
+
+/**
+ * Enumerates the kinds of bound a transposition table score can be.
+ */
+enum Bound {
+    BOUND_NONE  = 0,
+    BOUND_UPPER = 1,
+    BOUND_LOWER = 2,
+    BOUND_EXACT = 3
+};
+
+/**
+ * A decoded transposition table entry.
+ */
+struct TTEntry {
+    U16 move = 0;
+    int score = 0;
+    int depth = 0;
+    Bound bound = BOUND_NONE;
+};
+
+/**
+ * Fixed-size transposition table shared by all search threads.
+ *
+ * The table is an array of a power-of-two number of buckets, each one cache
+ * line holding four entries. Entries are written without locks: every slot
+ * stores its data word and the key XORed with that data word, so a slot torn
+ * by two threads writing at once no longer verifies against any key and is
+ * simply treated as a miss.
+ */
+class TranspositionTable {
+
+    struct Slot {
+        std::atomic<U64> key_xor_data{0};
+        std::atomic<U64> data{0};
+    };
+
+    struct alignas(64) Bucket {
+        Slot slots[4];
+    };
+
+    Bucket *buckets = nullptr;
+    U64 n_buckets = 0;
+    U8 generation = 0;
+
+    public:
+
+    /**
+     * Constructor - allocates a table of (at most) the given size.
+     * @param mb - size of the table in megabytes.
+     */
+    TranspositionTable(size_t mb = 16);
+
+    ~TranspositionTable();
+
+    TranspositionTable(const TranspositionTable &) = delete;
+    TranspositionTable &operator=(const TranspositionTable &) = delete;
+
+    /**
+     * Reallocates the table to (at most) the given size and clears it.
+     * Must not be called while a search is using the table.
+     * @param mb - size of the table in megabytes.
+     */
+    void resize(size_t mb);
+
+    /**
+     * Empties the table. Must not be called while a search is using it.
+     */
+    void clear();
+
+    /**
+     * Marks the start of a new search, so entries from earlier searches are
+     * preferred for replacement.
+     */
+    void new_search();
+
+    /**
+     * Looks up a position.
+     * @param key - the Zobrist hash of the position.
+     * @param entry - filled in with the stored entry on a hit.
+     * @return true if the position was found.
+     */
+    bool probe(U64 key, TTEntry &entry) const;
+
+    /**
+     * Stores the result of searching a position.
+     * @param key - the Zobrist hash of the position.
+     * @param depth - the depth the position was searched to.
+     * @param bound - whether score is exact, a lower or an upper bound.
+     * @param score - the score of the position.
+     * @param move - the best move found, or 0 if none.
+     */
+    void store(U64 key, int depth, Bound bound, int score, U16 move);
+
+    /**
+     * @return the number of entries (per mille) written during the current
+     * search, estimated from the first thousand entries.
+     */
+    int hashfull() const;
+};
@@ -1,10 +1,13 @@
+#include <algorithm>
 #include <iostream>
 #include "uciws.hpp"
 #include "board.hpp"
 #include "butils.hpp"
 
+#include <cctype>
 #include <string>
 #include <sstream>
+#include <stdexcept>
 #include <unistd.h>
 #include <thread>
 #include <vector>
@@ -25,14 +28,18 @@ std::vector<std::string> split(const std::string &s, char delim) {
     return elems;
 }
 
-UCIWSServer::UCIWSServer(std::string name, uint32_t port) {
+UCIWSServer::UCIWSServer(std::string name, uint32_t port, size_t hash_mb, int n_threads, bool ponder):
+    tt(hash_mb), pool(n_threads) {
     this->name = name;
     this->port = port;
+    this->n_threads = n_threads;
+    this->ponder = ponder;
 }
 
 void UCIWSServer::handle_message(ClientConnection conn, const std::string& message) {
 
     auto toks = split(message, ' ');
+    if (toks.empty()) return;
 
     if (toks[0] == "uci") {
         on_uci();
@@ -46,6 +53,9 @@ void UCIWSServer::handle_message(ClientConnection conn, const std::string& messa
     else if (toks[0] == "go") {
         on_go(toks);
     }
+    else if (toks[0] == "stop") {
+        on_stop();
+    }
     else if (toks[0] == "quit") {
         on_quit();
     }
@@ -75,8 +85,13 @@ void UCIWSServer::start() {
         });
     });
 
+    // Commands are handled one at a time on the main thread too, so the
+    // networking thread only ever moves frames. Searches run on the pool and
+    // send their bestmove from there, without a round trip through the loop.
     server.message([this](ClientConnection conn, const string& message) {
-        this->handle_message(conn, message);
+        this->main_evt_loop.post([conn, message, this]() {
+            this->handle_message(conn, message);
+        });
     });
     
     //Start the networking thread
@@ -89,6 +104,68 @@ void UCIWSServer::start() {
     main_evt_loop.run();
 }
 
+void UCIWSServer::stop_search() {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        ponder_state = PONDER_OFF;
+        abandoned = true;
+    }
+    if (e != nullptr) {
+        e->pondering = false;
+        e->stop = true;
+    }
+    search_jobs.wait();
+    if (e != nullptr) e->stop = false;
+}
+
+void UCIWSServer::run_search() {
+
+    e->find_best_move(*b);
+
+    while (true) {
+        U16 best_move = e->best_move;
+        bool pondering;
+        {
+            // play the move before sending it, and be ready to recognise the
+            // expected reply: the reply may arrive at once
+            std::lock_guard<std::mutex> lock(state_mutex);
+            pondering = ponder && !abandoned && best_move != 0 && e->ponder_move != 0;
+            if (best_move != 0) {
+                b->do_move_(best_move);
+                history.push_back(best_move);
+            }
+            if (pondering) {
+                delete ponder_board;
+                ponder_board = new Board(*b);
+                ponder_board->do_move_(e->ponder_move);
+                // after a reply that ends the game there is nothing to search
+                MoveList replies;
+                ponder_board->generate_legal(replies);
+                pondering = !replies.empty();
+            }
+            if (pondering) {
+                ponder_move = e->ponder_move;
+                ponder_state = PONDER_SEARCHING;
+                e->pondering = true;
+            }
+        }
+        server.broadcastMessage("bestmove " + move_to_str(best_move));
+        if (!pondering) break;
+
+        e->find_best_move(*ponder_board);
+
+        // on a miss the result is thrown away, but the table keeps what
+        // the search has found
+        std::lock_guard<std::mutex> lock(state_mutex);
+        bool hit = ponder_state == PONDER_HIT;
+        ponder_state = PONDER_OFF;
+        e->pondering = false;
+        if (!hit) break;
+    }
+
+    search_jobs.done();
+}
+
 void UCIWSServer::on_uci() {
     std::cout << "In method on_uci\n";
     server.broadcastMessage("uciok");
@@ -96,9 +173,24 @@ void UCIWSServer::on_uci() {
 
 void UCIWSServer::on_ucinewgame(std::vector<std::string>& toks) {
     std::cout << "In method on_ucinewgame\n";
-    if (b == nullptr) delete b;
-    if (e == nullptr) delete e;
+    stop_search();
+    delete b;
+    delete e;
+    b = nullptr;
+    {
+        // the ponder board may be of the previous game's layout
+        std::lock_guard<std::mutex> lock(state_mutex);
+        delete ponder_board;
+        ponder_board = nullptr;
+        ponder_state = PONDER_OFF;
+        ponder_move = 0;
+        history.clear();
+    }
     e = new Engine();
+    tt.clear();
+    e->tt = &tt;
+    e->n_threads = n_threads;
+    e->pool = &pool;
     e->time_left = std::chrono::milliseconds(stoi(toks[2]));
     if (toks[1] == "board-7-3") {
         b = new Board(SEVEN_THREE);
@@ -112,26 +204,150 @@ void UCIWSServer::on_ucinewgame(std::vector<std::string>& toks) {
     else {
         std::cout << "Received invalid board type from server\n";
     }
+    // the board type is fixed for the whole game, so the engine picks the
+    // search built for this layout once here
+    if (b != nullptr) e->set_board_type(b->data.board_type);
     server.broadcastMessage("newgameok");
 }
 
 void UCIWSServer::on_position(std::vector<std::string>& toks) {
     std::cout << "In method on_position\n";
-    if (toks.size() > 3) {
-        b->do_move_(str_to_move(toks[toks.size()-1]));
+    if (b == nullptr) return;
+
+    // position startpos moves m1 ... mN
+    std::vector<U16> moves;
+    for (size_t i=3; i<toks.size(); i++) {
+        U16 m = str_to_move(toks[i]);
+        if (m == 0) {
+            std::cout << "Malformed move " << toks[i] << ", keeping the previous position\n";
+            return;
+        }
+        moves.push_back(m);
+    }
+
+    bool hit = false;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        if (ponder_state == PONDER_SEARCHING) {
+            hit = moves.size() == history.size() + 1 && moves.back() == ponder_move
+                && std::equal(history.begin(), history.end(), moves.begin());
+            if (hit) ponder_state = PONDER_HIT;
+        }
     }
+    // anything else searching would be working on a stale board
+    if (!hit) stop_search();
+
+    std::lock_guard<std::mutex> lock(state_mutex);
+    sync_position(moves);
+}
+
+bool UCIWSServer::sync_position(const std::vector<U16>& moves) {
+
+    // the common case is one new move on top of the history
+    bool extends = moves.size() >= history.size()
+        && std::equal(history.begin(), history.end(), moves.begin());
+    Board *next = b;
+    size_t first = history.size();
+    if (!extends) {
+        std::cout << "Position does not extend our history, replaying it\n";
+        next = new Board(b->data.board_type);
+        first = 0;
+    }
+
+    // moves from the UI are checked before they are played, and an illegal
+    // one leaves the previous position as it was
+    for (size_t i=first; i<moves.size(); i++) {
+        MoveList legal;
+        next->generate_legal(legal);
+        if (!legal.contains(moves[i])) {
+            std::cout << "Illegal move " << move_to_str(moves[i])
+                      << ", keeping the previous position\n";
+            if (next != b) delete next;
+            else for (size_t j=first; j<i; j++) b->undo_move_();
+            return false;
+        }
+        next->do_move_(moves[i]);
+    }
+
+    if (next != b) {
+        delete b;
+        b = next;
+    }
+    history = moves;
+    return true;
 }
 
 void UCIWSServer::on_go(std::vector<std::string>& toks) {
     std::cout << "In method on_go\n";
-    // launch a thread to find the best move
-    e->time_left = std::chrono::milliseconds(stoi(toks[1]));
-    this->game_thread = std::thread([this]() {
-        e->find_best_move(*b);
-        server.broadcastMessage("bestmove " + move_to_str(e->best_move));
-        b->do_move_(e->best_move);
-    });
-    this->game_thread.join();
+    // go <ms> searches on the clock; movetime, depth, nodes and infinite
+    // set fixed limits instead
+    SearchLimits limits;
+    std::chrono::milliseconds time_left = e->time_left;
+    size_t i = 1;
+    try {
+        for (; i<toks.size(); i++) {
+            bool has_arg = i + 1 < toks.size() && isdigit(toks[i+1][0]);
+            if (toks[i] == "infinite") {
+                limits.infinite = true;
+            }
+            else if (toks[i] == "movetime" && has_arg) {
+                limits.movetime = std::chrono::milliseconds(stoll(toks[++i]));
+            }
+            else if (toks[i] == "depth" && has_arg) {
+                limits.depth = stoi(toks[++i]);
+            }
+            else if (toks[i] == "nodes" && has_arg) {
+                limits.nodes = stoull(toks[++i]);
+            }
+            else if (isdigit(toks[i][0])) {
+                time_left = std::chrono::milliseconds(stoll(toks[i]));
+            }
+            else {
+                std::cout << "Ignoring go argument " << toks[i] << "\n";
+            }
+        }
+    }
+    catch (const std::invalid_argument&) {
+        std::cout << "Malformed go argument " << toks[i] << ", keeping the previous limits\n";
+        limits = e->limits;
+        time_left = e->time_left;
+    }
+    catch (const std::out_of_range&) {
+        std::cout << "Go argument " << toks[i] << " out of range, keeping the previous limits\n";
+        limits = e->limits;
+        time_left = e->time_left;
+    }
+
+    {
+        // the pondering search already works on this position, and takes
+        // the limits over from here
+        std::lock_guard<std::mutex> lock(state_mutex);
+        if (ponder_state == PONDER_HIT) {
+            e->ponderhit(*b, limits, time_left);
+            return;
+        }
+    }
+
+    // the engine's fields are only written while nothing searches
+    stop_search();
+    e->limits = limits;
+    e->time_left = time_left;
+
+    // the search runs on the pool and answers by itself, so that the
+    // handler returns right away
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        abandoned = false;
+    }
+    search_jobs.add();
+    pool.submit([this]() { this->run_search(); });
+}
+
+void UCIWSServer::on_stop() {
+    std::cout << "In method on_stop\n";
+    // a search for our move still sends its bestmove, but does not go on to
+    // ponder; a pondering search is dropped
+    stop_search();
 }
 
 void UCIWSServer::on_quit() {
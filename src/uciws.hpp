@@ -5,9 +5,21 @@
 #include <thread>
 #include <asio/io_service.hpp>
 
+#include "threadpool.hpp"
 #include "server.hpp"
 #include "board.hpp"
 #include "engine.hpp"
+#include "tt.hpp"
+
+/**
+ * Where the pondering search is: not running, searching the expected reply,
+ * or that reply was played and the search now waits for the go command.
+ */
+enum PonderState {
+    PONDER_OFF,
+    PONDER_SEARCHING,
+    PONDER_HIT
+};
 
 class UCIWSServer {
 
@@ -17,26 +29,62 @@ class UCIWSServer {
     WebsocketServer server;
     
     std::thread server_thread;
-    std::thread game_thread;
     std::atomic<bool> running;
 
     uint32_t port;
     std::string name;
 
-    Board *b;
-    Engine *e;
+    Board *b = nullptr;
+    Engine *e = nullptr;
+
+    // Moves played on b since the start position, ours included.
+    std::vector<U16> history;
+    TranspositionTable tt;
+    int n_threads;
+
+    // Searches run on the pool; search_jobs counts the ones queued or
+    // running, so that the board and engine are not replaced under them.
+    ThreadPool pool;
+    WaitGroup search_jobs;
+
+    // With ponder set, the search goes on with the expected reply on the
+    // opponent's time. state_mutex guards the history and the ponder state,
+    // which both the search job and the position / go handlers update.
+    bool ponder;
+    std::mutex state_mutex;
+    PonderState ponder_state = PONDER_OFF;
+    U16 ponder_move = 0;
+    Board *ponder_board = nullptr;
 
-    UCIWSServer(std::string name, uint32_t port);
+    // Set by stop_search(): the search job still answers, but must not go on
+    // to ponder. Cleared when the next search is submitted.
+    bool abandoned = false;
+
+    UCIWSServer(std::string name, uint32_t port, size_t hash_mb = 64, int n_threads = 1, bool ponder = false);
 
     void start();
     void stop();
 
     void handle_message(ClientConnection conn, const std::string& message);
 
+    // Aborts the searches in flight (pondering included) and waits for them
+    // to finish.
+    void stop_search();
+
+    // Search job run on the pool: answers the go command, then ponders as
+    // long as the opponent keeps playing the expected replies.
+    void run_search();
+
+    // Brings b up to the given moves from the start position: plays the new
+    // ones, or replays the whole list if it does not extend the history.
+    // Returns false, leaving b and the history alone, on an illegal move.
+    bool sync_position(const std::vector<U16>& moves);
+
     void on_uci();
     void on_isready();
     void on_ucinewgame(std::vector<std::string>& toks);
     void on_position(std::vector<std::string>& toks);
     void on_go(std::vector<std::string>& toks);
+    void on_stop();
     void on_quit();
 };
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "constants.hpp"
+
+/**
+ * Random keys for Zobrist hashing: one per (color, piece type, square), one
+ * for black to move and one per board type. piece is indexed with color_idx
+ * and piece_idx. The keys are generated at compile time with splitmix64 so
+ * every build (and every engine process) hashes positions identically.
+ */
+struct ZobristKeys {
+    U64 piece[2][6][64] = {};
+    U64 black_to_play = 0;
+    U64 board_type[4] = {};
+};
+
+constexpr U64 splitmix64(U64 &state) {
+    U64 z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+constexpr ZobristKeys make_zobrist_keys() {
+
+    ZobristKeys keys;
+    U64 state = 0x526f6c6c657262ULL;
+    for (int c=0; c<2; c++) {
+        for (int p=0; p<6; p++) {
+            for (int sq=0; sq<64; sq++) {
+                keys.piece[c][p][sq] = splitmix64(state);
+            }
+        }
+    }
+    keys.black_to_play = splitmix64(state);
+    for (int t=0; t<4; t++) {
+        keys.board_type[t] = splitmix64(state);
+    }
+    return keys;
+}
+
+inline constexpr ZobristKeys zobrist_keys = make_zobrist_keys();
+
+#define zobrist_piece(p, sq) (zobrist_keys.piece[color_idx((p) & (WHITE | BLACK))][piece_idx(p)][(sq)])